@@ -9,6 +9,7 @@
 #include <memory>
 #include "core/util/Config.h"
 #include "core/tools/svm/TrainingSet.h"
+#include "core/tools/svm/BinaryTrainingSet.h"
 #include "core/tools/svm/libsvmopenmp/svm-train.h"
 #include "core/util/Matrix.h"
 #include "core/opencl/libsvm/OpenCLToolsTrain.h"
@@ -28,6 +29,27 @@ using namespace core::tools::svm::libsvmopenmp;
 using namespace core::process;
 using namespace core::util::RTTI;
 
+/**
+ * initializes OpenCL training tools on platform and device from configuration,
+ * used by -training and -gridsearch
+ */
+void initTrainingOpenCL() throw (SDException&){
+#ifdef _OPENCL
+    Config* conf = Config::getInstancePtr();
+    int platformId = 0;
+    int deviceId = 0;
+    string platformStr = conf->getPropertyValue("general.openCL.platformid");
+    string deviceStr = conf->getPropertyValue("general.openCL.deviceid");
+    int tmp = atoi(platformStr.c_str());
+    if (tmp != 0)
+        platformId = tmp;
+    tmp = atoi(deviceStr.c_str());
+    if (tmp != 0)
+        deviceId = tmp;
+    OpenCLToolsTrain::getInstancePtr()->init(platformId, deviceId, false);
+#endif
+}
+
 /**
  * global function for process single image
  * @param input
@@ -72,7 +94,7 @@ int main(int argc, char **argv) {
         try{
             TrainingSet ts(argv[2]);
             bool distribute = true;
-            string distributeStr = Config::getInstancePtr()->getPropertyValue("process.Training.distribute0and1");
+            string distributeStr = Config::getInstancePtr()->getPropertyValue("general.Training.distribute0and1");
             if (distributeStr.compare("false") == 0){
                 distribute = false;
             }
@@ -90,6 +112,23 @@ int main(int argc, char **argv) {
 #endif
         return 0;
     }
+    
+    if (argc >= 2 && strcmp(argv[1], "-exportset") == 0){
+        if (argc < 4){
+            cout << "exportset needs more parameters: input binary training set, output text file" << endl;
+            return 0;
+        }
+        try{
+            BinaryTrainingSet set;
+            set.open(argv[2]);
+            set.exportText(argv[3]);
+        }
+        catch (SDException& exc){
+            cout << exc.handleException() << endl;
+            exit(1);
+        }
+        return 0;
+    }
         
     if (argc >= 2 && strcmp(argv[1], "-training") == 0) {
         if (argc < 4){
@@ -97,21 +136,30 @@ int main(int argc, char **argv) {
             return 0;
         }
         try{
-            Config* conf = Config::getInstancePtr();
+            initTrainingOpenCL();
+            int val = train(argv[2], argv[3]);
+            cout << val << endl;
+        }
+        catch (SDException& e){
+            cout << e.handleException() << endl;
+            exit(1);
+        }
 #ifdef _OPENCL
-            int platformId = 0;
-            int deviceId = 0;
-            string platformStr = conf->getPropertyValue("general.openCL.platformid");
-            string deviceStr = conf->getPropertyValue("general.openCL.deviceid");
-            int tmp = atoi(platformStr.c_str());
-            if (tmp != 0)
-                platformId = tmp;
-            tmp = atoi(deviceStr.c_str());
-            if (tmp != 0)
-                deviceId = tmp;
-            OpenCLToolsTrain::getInstancePtr()->init(platformId, deviceId, false);
+        OpenclTools::getInstancePtr()->cleanUp();
+        OpenclTools::destroy();        
 #endif
-            int val = train(argv[2], argv[3]);
+        Config::destroy();
+        return 0;
+    }
+    
+    if (argc >= 2 && strcmp(argv[1], "-gridsearch") == 0) {
+        if (argc < 5){
+            cout << "gridsearch needs more parameters: input data file, output model file, output results file" << endl;
+            return 0;
+        }
+        try{
+            initTrainingOpenCL();
+            int val = grid_search(argv[2], argv[3], argv[4]);
             cout << val << endl;
         }
         catch (SDException& e){
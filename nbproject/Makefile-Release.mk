@@ -44,7 +44,16 @@ OBJECTFILES= \
 	${OBJECTDIR}/src/cpp/core/opencv/OpenCVTools.o \
 	${OBJECTDIR}/src/cpp/core/process/MakeSetProcessor.o \
 	${OBJECTDIR}/src/cpp/core/process/TrainingProcessor.o \
+	${OBJECTDIR}/src/cpp/core/tools/image/BitMask.o \
+	${OBJECTDIR}/src/cpp/core/tools/image/ConnectedComponents.o \
+	${OBJECTDIR}/src/cpp/core/tools/image/ImageContext.o \
+	${OBJECTDIR}/src/cpp/core/tools/image/Morphology.o \
+	${OBJECTDIR}/src/cpp/core/tools/image/TsaiMask.o \
+	${OBJECTDIR}/src/cpp/core/tools/svm/BinaryTrainingSet.o \
+	${OBJECTDIR}/src/cpp/core/tools/svm/TrainingSampler.o \
 	${OBJECTDIR}/src/cpp/core/tools/svm/TrainingSet.o \
+	${OBJECTDIR}/src/cpp/core/tools/svm/libsvmopenmp/svm-grid.o \
+	${OBJECTDIR}/src/cpp/core/tools/svm/libsvmopenmp/svm-read.o \
 	${OBJECTDIR}/src/cpp/core/tools/svm/libsvmopenmp/svm-train.o \
 	${OBJECTDIR}/src/cpp/core/util/Cofig.o \
 	${OBJECTDIR}/src/cpp/core/util/MemTracker.o \
@@ -59,6 +68,7 @@ OBJECTFILES= \
 	${OBJECTDIR}/src/cpp/shadowdetection/opencl/OpenCLToolsImage.o \
 	${OBJECTDIR}/src/cpp/shadowdetection/process/ShadowDetectionProcessor.o \
 	${OBJECTDIR}/src/cpp/shadowdetection/tools/image/ImageShadowParameters.o \
+	${OBJECTDIR}/src/cpp/shadowdetection/tools/image/MaskCleanup.o \
 	${OBJECTDIR}/src/cpp/shadowdetection/tools/image/ResultFixer.o \
 	${OBJECTDIR}/src/cpp/skydetection/SkyDetection.o \
 	${OBJECTDIR}/src/cpp/thirdparty/lib_svm/svm.o
@@ -133,11 +143,56 @@ ${OBJECTDIR}/src/cpp/core/process/TrainingProcessor.o: src/cpp/core/process/Trai
 	${RM} "$@.d"
 	$(COMPILE.cc) -O3 -I/usr/local/include/opencv -Isrc/cpp -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/cpp/core/process/TrainingProcessor.o src/cpp/core/process/TrainingProcessor.cpp
 
+${OBJECTDIR}/src/cpp/core/tools/image/BitMask.o: src/cpp/core/tools/image/BitMask.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/cpp/core/tools/image
+	${RM} "$@.d"
+	$(COMPILE.cc) -O3 -I/usr/local/include/opencv -Isrc/cpp -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/cpp/core/tools/image/BitMask.o src/cpp/core/tools/image/BitMask.cpp
+
+${OBJECTDIR}/src/cpp/core/tools/image/ConnectedComponents.o: src/cpp/core/tools/image/ConnectedComponents.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/cpp/core/tools/image
+	${RM} "$@.d"
+	$(COMPILE.cc) -O3 -I/usr/local/include/opencv -Isrc/cpp -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/cpp/core/tools/image/ConnectedComponents.o src/cpp/core/tools/image/ConnectedComponents.cpp
+
+${OBJECTDIR}/src/cpp/core/tools/image/ImageContext.o: src/cpp/core/tools/image/ImageContext.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/cpp/core/tools/image
+	${RM} "$@.d"
+	$(COMPILE.cc) -O3 -I/usr/local/include/opencv -Isrc/cpp -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/cpp/core/tools/image/ImageContext.o src/cpp/core/tools/image/ImageContext.cpp
+
+${OBJECTDIR}/src/cpp/core/tools/image/Morphology.o: src/cpp/core/tools/image/Morphology.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/cpp/core/tools/image
+	${RM} "$@.d"
+	$(COMPILE.cc) -O3 -I/usr/local/include/opencv -Isrc/cpp -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/cpp/core/tools/image/Morphology.o src/cpp/core/tools/image/Morphology.cpp
+
+${OBJECTDIR}/src/cpp/core/tools/image/TsaiMask.o: src/cpp/core/tools/image/TsaiMask.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/cpp/core/tools/image
+	${RM} "$@.d"
+	$(COMPILE.cc) -O3 -I/usr/local/include/opencv -Isrc/cpp -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/cpp/core/tools/image/TsaiMask.o src/cpp/core/tools/image/TsaiMask.cpp
+
+${OBJECTDIR}/src/cpp/core/tools/svm/BinaryTrainingSet.o: src/cpp/core/tools/svm/BinaryTrainingSet.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/cpp/core/tools/svm
+	${RM} "$@.d"
+	$(COMPILE.cc) -O3 -I/usr/local/include/opencv -Isrc/cpp -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/cpp/core/tools/svm/BinaryTrainingSet.o src/cpp/core/tools/svm/BinaryTrainingSet.cpp
+
+${OBJECTDIR}/src/cpp/core/tools/svm/TrainingSampler.o: src/cpp/core/tools/svm/TrainingSampler.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/cpp/core/tools/svm
+	${RM} "$@.d"
+	$(COMPILE.cc) -O3 -I/usr/local/include/opencv -Isrc/cpp -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/cpp/core/tools/svm/TrainingSampler.o src/cpp/core/tools/svm/TrainingSampler.cpp
+
 ${OBJECTDIR}/src/cpp/core/tools/svm/TrainingSet.o: src/cpp/core/tools/svm/TrainingSet.cpp 
 	${MKDIR} -p ${OBJECTDIR}/src/cpp/core/tools/svm
 	${RM} "$@.d"
 	$(COMPILE.cc) -O3 -I/usr/local/include/opencv -Isrc/cpp -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/cpp/core/tools/svm/TrainingSet.o src/cpp/core/tools/svm/TrainingSet.cpp
 
+${OBJECTDIR}/src/cpp/core/tools/svm/libsvmopenmp/svm-grid.o: src/cpp/core/tools/svm/libsvmopenmp/svm-grid.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/cpp/core/tools/svm/libsvmopenmp
+	${RM} "$@.d"
+	$(COMPILE.cc) -O3 -I/usr/local/include/opencv -Isrc/cpp -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/cpp/core/tools/svm/libsvmopenmp/svm-grid.o src/cpp/core/tools/svm/libsvmopenmp/svm-grid.cpp
+
+${OBJECTDIR}/src/cpp/core/tools/svm/libsvmopenmp/svm-read.o: src/cpp/core/tools/svm/libsvmopenmp/svm-read.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/cpp/core/tools/svm/libsvmopenmp
+	${RM} "$@.d"
+	$(COMPILE.cc) -O3 -I/usr/local/include/opencv -Isrc/cpp -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/cpp/core/tools/svm/libsvmopenmp/svm-read.o src/cpp/core/tools/svm/libsvmopenmp/svm-read.cpp
+
 ${OBJECTDIR}/src/cpp/core/tools/svm/libsvmopenmp/svm-train.o: src/cpp/core/tools/svm/libsvmopenmp/svm-train.cpp 
 	${MKDIR} -p ${OBJECTDIR}/src/cpp/core/tools/svm/libsvmopenmp
 	${RM} "$@.d"
@@ -208,6 +263,11 @@ ${OBJECTDIR}/src/cpp/shadowdetection/tools/image/ImageShadowParameters.o: src/cp
 	${RM} "$@.d"
 	$(COMPILE.cc) -O3 -I/usr/local/include/opencv -Isrc/cpp -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/cpp/shadowdetection/tools/image/ImageShadowParameters.o src/cpp/shadowdetection/tools/image/ImageShadowParameters.cpp
 
+${OBJECTDIR}/src/cpp/shadowdetection/tools/image/MaskCleanup.o: src/cpp/shadowdetection/tools/image/MaskCleanup.cpp 
+	${MKDIR} -p ${OBJECTDIR}/src/cpp/shadowdetection/tools/image
+	${RM} "$@.d"
+	$(COMPILE.cc) -O3 -I/usr/local/include/opencv -Isrc/cpp -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/cpp/shadowdetection/tools/image/MaskCleanup.o src/cpp/shadowdetection/tools/image/MaskCleanup.cpp
+
 ${OBJECTDIR}/src/cpp/shadowdetection/tools/image/ResultFixer.o: src/cpp/shadowdetection/tools/image/ResultFixer.cpp 
 	${MKDIR} -p ${OBJECTDIR}/src/cpp/shadowdetection/tools/image
 	${RM} "$@.d"
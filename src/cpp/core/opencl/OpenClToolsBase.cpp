@@ -80,6 +80,10 @@ namespace core{
             }
         }
         
+        string OpenClBase::getGeneratedSource(){
+            return string("");
+        }
+        
         size_t OpenClBase::shrRoundUp(size_t localSize, size_t allSize) {
             if (allSize % localSize == 0) {
                 return allSize;
@@ -119,8 +123,11 @@ namespace core{
                     VectorRaii<char> vraiiBuff(buffer);
                     kernelFile.read(buffer, MAX_SRC_SIZE);
                     if (kernelFile.eof()) {
-                        size_t readBytes = kernelFile.gcount();
-                        program = clCreateProgramWithSource(context, 1, (const char **) &buffer, &readBytes, &err);
+                        string source(buffer, kernelFile.gcount());
+                        source += getGeneratedSource();
+                        const char* sourcePtr = source.c_str();
+                        size_t readBytes = source.size();
+                        program = clCreateProgramWithSource(context, 1, &sourcePtr, &readBytes, &err);
                         err_check(err, programFileName + " clCreateProgramWithSource");
                         cout << "Build program: " << programFileName << " started" << endl;
                         err = clBuildProgram(program, 1, &device, 0, NULL, NULL);
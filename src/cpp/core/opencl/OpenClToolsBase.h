@@ -150,6 +150,12 @@ namespace core{
              * class names used in config
              */
             virtual std::string getClassName() = 0;
+            /**
+             * source generated at runtime, appended to program file source before build
+             * @return 
+             * empty string if class doesn't generate any code
+             */
+            virtual std::string getGeneratedSource();
         public:
             /**
              * constructor. Calls initVars()
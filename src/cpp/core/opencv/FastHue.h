@@ -0,0 +1,118 @@
+#ifndef __FAST_HUE_H__
+#define __FAST_HUE_H__
+
+#include <math.h>
+#include <string>
+#include "typedefs.h"
+
+//hues closer than this (in degrees) to integer are recalculated with atan2
+#define FAST_HUE_EPSILON 1e-3f
+#define FAST_HUE_STRINGIFY(x) #x
+#define FAST_HUE_TO_STRING(x) FAST_HUE_STRINGIFY(x)
+
+namespace core{
+    namespace opencv{
+
+        /**
+         * hue in whole degrees as calculated by RGBtoHSI conversions,
+         * atan2 of chroma components truncated to integer
+         * @param v1
+         * first chroma component
+         * @param v2
+         * second chroma component
+         * @return
+         * hue, in [0, 360]
+         */
+        inline uint exactHue(float v1, float v2){
+            float fH = atan2(v2, v1);
+            fH = radToDegrees(fH);
+            if (fH < -360.f)
+                fH = -360.f;
+            if (fH < 0.f)
+                fH += 360.f;
+            if (fH > 360.f)
+                fH = 360.f;
+            return (uint)fH;
+        }
+
+        /**
+         * atan2 free hue approximation. Angle is reduced to first octant and atan is evaluated with
+         * Cephes minimax polynomial, max error is about 2e-5 degrees. Hues within FAST_HUE_EPSILON of
+         * integer degree are recalculated with exactHue, so result is same as exactHue for all
+         * 2^24 colors of both HSI variants (about 1% of colors, mostly hues which are exact multiples
+         * of 60 degrees, take atan2 path)
+         * @param v1
+         * first chroma component
+         * @param v2
+         * second chroma component
+         * @return
+         * hue, in [0, 360]
+         */
+        inline uint fastHue(float v1, float v2){
+            float ax = fabsf(v1);
+            float ay = fabsf(v2);
+            float maxVal = (ax > ay) ? ax : ay;
+            float minVal = (ax > ay) ? ay : ax;
+            float t = (maxVal > 0.f) ? minVal / maxVal : 0.f;
+            //reduce to [-tan(pi/8), tan(pi/8)]
+            bool reduced = t > 0.41421356f;
+            float x = reduced ? (t - 1.f) / (t + 1.f) : t;
+            float z = x * x;
+            float angle = (((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z -
+                            3.33329491539e-1f) * z * x + x;
+            angle += reduced ? 0.78539816f : 0.f;
+            float degrees = angle * 57.2957795f;
+            degrees = (ay > ax) ? 90.f - degrees : degrees;
+            degrees = (v1 < 0.f) ? 180.f - degrees : degrees;
+            degrees = (v2 < 0.f) ? 360.f - degrees : degrees;
+            float fraction = degrees - floorf(degrees);
+            if (fraction < FAST_HUE_EPSILON || fraction > 1.f - FAST_HUE_EPSILON)
+                return exactHue(v1, v2);
+            return (uint)degrees;
+        }
+
+        /**
+         * OpenCL source of exactHue and fastHue, same operations as C++ versions.
+         * Expects radToDegrees() helper to be defined in program
+         * @return
+         * source of exactHue and fastHue OpenCL functions
+         */
+        inline std::string fastHueClSource(){
+            return std::string(
+                "\nuint exactHue(float v1, float v2){\n"
+                "    float fH = radToDegrees(atan2(v2, v1));\n"
+                "    if (fH < -360.f)\n"
+                "        fH = -360.f;\n"
+                "    if (fH < 0.f)\n"
+                "        fH += 360.f;\n"
+                "    if (fH > 360.f)\n"
+                "        fH = 360.f;\n"
+                "    return convert_uint_rtz(fH);\n"
+                "}\n"
+                "\nuint fastHue(float v1, float v2){\n"
+                "    float ax = fabs(v1);\n"
+                "    float ay = fabs(v2);\n"
+                "    float maxVal = (ax > ay) ? ax : ay;\n"
+                "    float minVal = (ax > ay) ? ay : ax;\n"
+                "    float t = (maxVal > 0.f) ? minVal / maxVal : 0.f;\n"
+                "    bool reduced = t > 0.41421356f;\n"
+                "    float x = reduced ? (t - 1.f) / (t + 1.f) : t;\n"
+                "    float z = x * x;\n"
+                "    float angle = (((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z -\n"
+                "                    3.33329491539e-1f) * z * x + x;\n"
+                "    angle += reduced ? 0.78539816f : 0.f;\n"
+                "    float degrees = angle * 57.2957795f;\n"
+                "    degrees = (ay > ax) ? 90.f - degrees : degrees;\n"
+                "    degrees = (v1 < 0.f) ? 180.f - degrees : degrees;\n"
+                "    degrees = (v2 < 0.f) ? 360.f - degrees : degrees;\n"
+                "    float fraction = degrees - floor(degrees);\n"
+                "    if (fraction < " FAST_HUE_TO_STRING(FAST_HUE_EPSILON) " || fraction > 1.f - " FAST_HUE_TO_STRING(FAST_HUE_EPSILON) ")\n"
+                "        return exactHue(v1, v2);\n"
+                "    return convert_uint_rtz(degrees);\n"
+                "}\n");
+        }
+
+    }
+}
+
+#endif
@@ -1,7 +1,16 @@
 #include <iostream>
 #include "OpenCV2Tools.h"
 #include "core/util/Config.h"
+#include "core/tools/image/ImageView.h"
 #include <vector>
+#include <cfloat>
+#include <algorithm>
+#if defined _OPENMP_MY
+#include <omp.h>
+#endif
+
+//fixed point precision used by OpenCV for 8bit HSV conversion
+#define HSV_SHIFT 12
 
 namespace core{
     namespace opencv2 {
@@ -10,38 +19,43 @@ namespace core{
         using namespace cv;
         using namespace cv::ocl;
         using namespace core::util;        
+        using namespace core::tools::image;
         
         unsigned int* OpenCV2Tools::convertImagetoHSI  (const Mat* image, int& height, int& width, int& channels,
                                              void (*convertFunc)(unsigned char, unsigned char, unsigned char, unsigned int&, unsigned char&, unsigned char&)){
             if (image == 0 || image->data == 0){
                 return 0;
             }
-            height = image->size().height;
-            width = image->size().width;
-            channels = image->channels();
+            ConstColorView imageView(*image);
+            height = imageView.getRows();
+            width = imageView.getCols();
+            channels = ConstColorView::channels;
             uint* retArr = 0;
             retArr = New uint[height * width * channels];
             if (retArr == 0){
                 SDException exc(SHADOW_NO_MEM, "Convert to HSI");
+                throw exc;
             }
-            unsigned char* data = (unsigned char*) image->data;
-            size_t step = image->step;
-            for (int i = 0; i < height; i++) {
+            int rowSize = width * channels;
+            int i;
+#if defined _OPENMP_MY
+#pragma omp parallel for private(i)
+#endif
+            for (i = 0; i < height; i++) {
+                const uchar* pixel = imageView.row(i);
+                uint* retRow = retArr + i * rowSize;
                 for (int j = 0; j < width; j++) {
-                    unsigned char B = data[i * step + j * channels + 0];
-                    unsigned char G = data[i * step + j * channels + 1];
-                    unsigned char R = data[i * step + j * channels + 2];
-
                     unsigned int H;
                     unsigned char S;
                     unsigned char I;
 
-                    convertFunc(R, G, B, H, S, I);
-                    int index = i * width * channels + j * channels;
+                    convertFunc(pixel[2], pixel[1], pixel[0], H, S, I);
 
-                    retArr[index + 0] = H;
-                    retArr[index + 1] = (unsigned int) S;
-                    retArr[index + 2] = (unsigned int) I;
+                    retRow[0] = H;
+                    retRow[1] = (unsigned int) S;
+                    retRow[2] = (unsigned int) I;
+                    pixel += ConstColorView::channels;
+                    retRow += ConstColorView::channels;
                 }
             }
             return retArr;
@@ -208,6 +222,11 @@ namespace core{
             }
             return image;
         }
+        
+        void OpenCV2Tools::convertToHSVAndHLSOcl(const oclMat& src, oclMat& hsv, oclMat& hls){
+            ocl::cvtColor(src, hsv, CV_BGR2HSV);
+            ocl::cvtColor(src, hls, CV_BGR2HLS);
+        }
 #endif
         
         Mat* OpenCV2Tools::convertToHSV(const Mat* src) throw (SDException&){
@@ -254,6 +273,114 @@ namespace core{
             return ret;
         }
         
+        /**
+         * division tables, same as ones used by OpenCV for 8bit BGR to HSV conversion
+         */
+        struct HSVDivTables{
+            int sdiv[256];
+            int hdiv[256];
+            
+            HSVDivTables(){
+                sdiv[0] = hdiv[0] = 0;
+                for (int i = 1; i < 256; i++){
+                    sdiv[i] = saturate_cast<int>((255 << HSV_SHIFT) / (1. * i));
+                    hdiv[i] = saturate_cast<int>((180 << HSV_SHIFT) / (6. * i));
+                }
+            }
+        };
+        
+        /**
+         * converts single row. HSV part is fixed point as cvtColor CV_BGR2HSV,
+         * HLS part is float as cvtColor CV_BGR2HLS, both share min/max search
+         */
+        void convertRowToHSVAndHLS( const uchar* src, uchar* hsv, uchar* hls, int width, 
+                                    const HSVDivTables& tables){
+            const float scale = 1.f / 255.f;
+            for (int j = 0; j < width; j++, src += 3, hsv += 3, hls += 3){
+                int b = src[0], g = src[1], r = src[2];
+                int vmax = std::max(std::max(b, g), r);
+                int vmin = std::min(std::min(b, g), r);
+                int diff = vmax - vmin;
+                int vr = vmax == r ? -1 : 0;
+                int vg = vmax == g ? -1 : 0;
+                
+                int s = (diff * tables.sdiv[vmax] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+                int h = (vr & (g - b)) + (~vr & ((vg & (b - r + 2 * diff)) + ((~vg) & (r - g + 4 * diff))));
+                h = (h * tables.hdiv[diff] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+                h += h < 0 ? 180 : 0;
+                hsv[0] = saturate_cast<uchar>(h);
+                hsv[1] = (uchar)s;
+                hsv[2] = (uchar)vmax;
+                
+                float bf = b * scale, gf = g * scale, rf = r * scale;
+                float vmaxf = vmax * scale, vminf = vmin * scale;
+                float difff = vmaxf - vminf;
+                float hf = 0.f, sf = 0.f;
+                float lf = (vmaxf + vminf) * 0.5f;
+                if (difff > FLT_EPSILON){
+                    sf = lf < 0.5f ? difff / (vmaxf + vminf) : difff / (2 - vmaxf - vminf);
+                    difff = 60.f / difff;
+                    if (vr)
+                        hf = (gf - bf) * difff;
+                    else if (vg)
+                        hf = (bf - rf) * difff + 120.f;
+                    else
+                        hf = (rf - gf) * difff + 240.f;
+                    if (hf < 0.f)
+                        hf += 360.f;
+                }
+                hls[0] = saturate_cast<uchar>(hf * 0.5f);
+                hls[1] = saturate_cast<uchar>(lf * 255.f);
+                hls[2] = saturate_cast<uchar>(sf * 255.f);
+            }
+        }
+        
+        void OpenCV2Tools::convertToHSVAndHLS(const Mat* src, Mat*& hsv, Mat*& hls) throw (SDException&){
+            hsv = 0;
+            hls = 0;
+            if (src == 0 || src->data == 0){
+                return;
+            }
+            if (src->type() != CV_8UC3){
+                SDException exc(SHADOW_INVALID_IMAGE_FORMAT, "OpenCV2Tools::convertToHSVAndHLS");
+                throw exc;
+            }
+#ifdef _OPENCL
+            oclMat oclSrc(*src);
+            oclMat oclHsv, oclHls;
+            convertToHSVAndHLSOcl(oclSrc, oclHsv, oclHls);
+            hsv = New Mat(oclHsv);
+            hls = New Mat(oclHls);
+#else
+            hsv = New Mat(src->rows, src->cols, CV_8UC3);
+            hls = New Mat(src->rows, src->cols, CV_8UC3);
+#endif
+            if (hsv == 0 || hls == 0){
+                if (hsv)
+                    Delete(hsv);
+                if (hls)
+                    Delete(hls);
+                hsv = hls = 0;
+                SDException exc(SHADOW_NO_MEM, "OpenCV2Tools::convertToHSVAndHLS");
+                throw exc;
+            }
+#ifndef _OPENCL
+            static const HSVDivTables tables;
+            int height = src->rows;
+            int width = src->cols;
+            ConstColorView srcView(*src);
+            ImageView<uchar, 3> hsvView(*hsv);
+            ImageView<uchar, 3> hlsView(*hls);
+            int i;
+#if defined _OPENMP_MY
+#pragma omp parallel for private(i)
+#endif
+            for (i = 0; i < height; i++){
+                convertRowToHSVAndHLS(srcView.row(i), hsvView.row(i), hlsView.row(i), width, tables);
+            }
+#endif
+        }
+        
         /**
          * don't want this parallel
          * @param src
@@ -382,168 +509,6 @@ namespace core{
             int index = y * step + x * channels + channelIndex;
             image.data[index] = newValue;
         }
-        
-        struct List{
-            unordered_set< Pair<uint>*, hash< Pair<uint>* >, eqKeyVal> container;
-            
-            List(){}
-            
-            ~List() {
-                unordered_set< Pair<uint>*, hash< Pair<uint>* >, eqKeyVal >::iterator iter = container.begin();
-                while (iter != container.end()) {
-                    Pair<uint>* location = *iter;
-                    Delete(location);
-                    iter++;
-                }
-            }
-            
-            Pair<uint>* pop(){
-                unordered_set< Pair<uint>*, hash< Pair<uint>* >, eqKeyVal >::iterator iter = container.begin();
-                Pair<uint>* retVal = *iter;
-                container.erase(iter);
-                return retVal;
-            }
-            
-            void push(Pair<uint>* element){
-                container.insert(element);
-            }
-            
-            bool contains(Pair<uint>* element) const{
-                unordered_set< Pair<uint>*, hash< Pair<uint>* >, eqKeyVal>::const_iterator iter = container.find(element);
-                return !(iter == container.end());
-            }
-            
-            size_t size(){
-                return container.size();
-            }
-            
-            vector< Pair<uint>* > getElements(){
-                vector< Pair<uint>* > retVec;
-                 unordered_set< Pair<uint>*, hash< Pair<uint>* >, eqKeyVal >::iterator iter = container.begin();
-                 while (iter != container.end()){
-                     Pair<uint>* location = *iter;
-                     retVec.push_back(location);
-                     iter++;
-                 }
-                 return retVec;
-            }
-        };
-        
-        vector< Pair<uint>* >* getNeighbours(Pair<uint>* location, const Mat& image,
-                const List& openList, const List& closedList, const uint& color){
-            int startX = location->getFirst() - 1;
-            startX = clamp<int>(startX, 0, image.cols - 1);
-            int endX = location->getFirst() + 1;
-            endX = clamp<int>(endX, 0, image.cols - 1);
-            int startY = location->getSecond() - 1;
-            startY = clamp<int>(startY, 0, image.rows - 1);
-            int endY = location->getSecond() + 1U;
-            endY = clamp<int>(endY, 0, image.rows - 1);
-            vector< Pair<uint>* >* retVec = New vector< Pair<uint>* >();
-            for (int i = startX; i <= endX; i++){
-                for (int j = startY; j <= endY; j++){
-                    if ((uint)i != location->getFirst() || (uint)j != location->getSecond()){
-                        uchar currentColor = OpenCV2Tools::getChannelValue(image, i, j, 0);
-                        if (currentColor == color){
-                            Pair<uint>* nLocation = New Pair<uint>((uint)i, (uint)j);
-                            if (openList.contains(nLocation) == false && closedList.contains(nLocation) == false){
-                                retVec->push_back(nLocation);
-                            }
-                            else{
-                                Delete(nLocation);
-                            }
-                        }
-                    }
-                }
-            }
-            return retVec;
-        }                
-        
-        void doFloodFill(Pair<uint>& location, const Mat& image, const uint& color,
-                        List& openList, List& closedList){
-            uint pixel = OpenCV2Tools::getChannelValue(image, location, 0);
-            if (pixel == color){
-                if (openList.contains(&location) == false && closedList.contains(&location) == false){
-                    Pair<uint>* locationCopy = New Pair<uint>(location);
-                    openList.push(locationCopy);
-                    while (openList.size() > 0){
-                        Pair<uint>* loc = openList.pop();
-                        closedList.push(loc);
-                        UNIQUE_PTR(vector< Pair<uint>* >) neighboursPtr(getNeighbours(loc, image, openList, 
-                                                                            closedList, color));
-                        for (uint i = 0; i < neighboursPtr->size(); i++){
-                            Pair<uint>* neighbour = (*neighboursPtr)[i];
-                            openList.push(neighbour);
-                        }
-                    }
-                }
-            }            
-        }
-        
-        bool alreadyProcessed(Pair<uint>& location, const list< unordered_set< Pair<uint> >* >* processedRegions){
-            list< unordered_set< Pair<uint> >* >::const_iterator iter = processedRegions->begin();
-            while (iter != processedRegions->end()){
-                unordered_set< Pair<uint> >* locationsSet = *iter;
-                unordered_set< Pair<uint> >::iterator foundIter = locationsSet->find(location);
-                if (foundIter != locationsSet->end()){
-                    return true;
-                }
-                ++iter;
-            }
-            return false;
-        }
-        
-        bool compareSets(const unordered_set< Pair<uint> >* first, const unordered_set< Pair<uint> >* second){
-            return first->size() > second->size();
-        }
-        
-        list< unordered_set< Pair<uint> >* >* OpenCV2Tools::getRegionsOfColor(const cv::Mat& image, const uint& color) throw (SDException&){
-            if (image.data == 0){
-                SDException exc(SHADOW_INVALID_IMAGE_FORMAT, "OpenCV2Tools::getRegionsOfColor");
-                throw exc;
-            }
-            list< unordered_set< Pair<uint> >* >* retList = New list< unordered_set< Pair<uint> >* >();
-            uint rows = image.rows;
-            uint cols = image.cols;
-            for (uint i = 0; i < rows; i++){
-                for (uint j = 0; j < cols; j++){
-                    Pair<uint> location(j, i);
-                    uint pixel = getChannelValue(image, location, 0);
-                    if (pixel == color && alreadyProcessed(location, retList) == false){
-                        List openList;
-                        List closedList;
-                        doFloodFill(location, image, color, openList, closedList);
-                        unordered_set< Pair<uint> >* region = New unordered_set< Pair<uint> >();
-                        vector< Pair<uint>* > regionLocations = closedList.getElements();
-                        for (uint k = 0; k < regionLocations.size(); k++){
-                            region->insert(*regionLocations[k]);
-                        }
-                        retList->push_back(region);
-                    }
-                }
-            }
-            retList->sort(compareSets);
-            return retList;
-        }
-        
-        void OpenCV2Tools::destroySegments(list< unordered_set< Pair<uint> >* >* segments) throw (SDException&){
-            if (segments == 0){
-                SDException exc(SHADOW_NULL_POINTER, "OpenCV2Tools::destroySegments");
-                throw exc;
-            }
-            list< unordered_set< Pair<uint> >* >::iterator iter = segments->begin();
-            while (iter != segments->end()){
-                unordered_set< Pair<uint> >* segment = *iter;
-                if (segment == 0){
-                    SDException exc(SHADOW_NULL_POINTER, "OpenCV2Tools::destroySegments segment");
-                    throw exc;
-                }
-                Delete(segment);
-                iter++;
-            }
-            segments->clear();
-            Delete(segments);
-        }
 
     }
 }
\ No newline at end of file
@@ -12,8 +12,6 @@
 #include "opencv2/core/core.hpp"
 #include "opencv2/highgui/highgui.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
-#include <list>
-#include <unordered_set>
 #include "typedefs.h"
 
 namespace core{
@@ -132,6 +130,18 @@ namespace core{
              * pointer to Mat object representing image in HLS format 
              */
             static cv::Mat* convertToHLS(const cv::Mat* src) throw (SDException&);
+            /**
+             * converts image to HSV and HLS reading source data once. Results are same as 
+             * results of convertToHSV() and convertToHLS()
+             * @param src
+             * input image as pointer to Mat object, BGR channel order, 8bit three channels
+             * @param hsv
+             * output, pointer to Mat object representing image in HSV format, caller is owner
+             * @param hls
+             * output, pointer to Mat object representing image in HLS format, caller is owner
+             */
+            static void convertToHSVAndHLS( const cv::Mat* src, cv::Mat*& hsv, 
+                                            cv::Mat*& hls) throw (SDException&);
             /**
              * return region of interest for specified image. Region is specified by location and dimensions.
              * Returned image points to original image data.
@@ -201,24 +211,6 @@ namespace core{
              */
             static void setChannelValue(cv::Mat& image, Pair<uint> location, 
                                         uchar channelIndex, uchar newValue) throw (SDException&);
-            /**
-             * Segmentize image by value of first channel.
-             * @param image
-             * input image as pointer to Mat object
-             * @param color
-             * value of first channel by which image will be segmentised
-             * @return 
-             * List of unconnected regions. Each region is set of connected pixels, and each pixel's first channel is equals to color value
-             */
-            static std::list< std::unordered_set< Pair<uint> >* >* getRegionsOfColor(const cv::Mat& image, 
-                                                                                        const uint& color) throw (SDException&);
-            /**
-             * 
-             * @param segments
-             * segments which will be freed up from memory
-             * Segments are returned from getRegionsOfColor() method
-             */
-            static void destroySegments(std::list< std::unordered_set< Pair<uint> >* >* segments) throw (SDException&);
 #ifdef _OPENCL
             /**
              * init global variables needed for openCV openCL processing
@@ -240,6 +232,17 @@ namespace core{
              * merge of first and second image using OR operator, represented as single channel pointer to Mat object
              */
             static cv::Mat* joinTwoOcl(const cv::Mat& src1, const cv::Mat& src2);
+            /**
+             * converts image already uploaded to device to HSV and HLS, results stay on device
+             * @param src
+             * input image, BGR channel order
+             * @param hsv
+             * output image in HSV format
+             * @param hls
+             * output image in HLS format
+             */
+            static void convertToHSVAndHLSOcl(  const cv::ocl::oclMat& src, cv::ocl::oclMat& hsv, 
+                                                cv::ocl::oclMat& hls);
 #endif
         };
 
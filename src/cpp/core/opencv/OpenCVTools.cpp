@@ -1,4 +1,5 @@
 #include "OpenCVTools.h"
+#include "FastHue.h"
 #include "typedefs.h"
 #include "core/util/MemTracker.h"
 
@@ -18,23 +19,12 @@ namespace core{
 
             //delta = max - min;
             float fS;
-            float fH;
 
             float v1 = 0.5f * (2.f * r - g - b);
             float v2 = 0.5f * sqrt(3.f) * (g - b);
 
-            fH = atan2(v2, v1);
-            fH = radToDegrees(fH);
+            h = fastHue(v1, v2);
 
-            if (fH < -360.f)
-                fH = -360.f;
-
-            if (fH < 0.)
-                fH += 360.f;
-
-            if (fH > 360.f)
-                fH = 360.f;
-            
             if (i != 0){
                 fS = 1.f - ((float)min / (float) i);
             }
@@ -48,7 +38,6 @@ namespace core{
                 fS = 0.f;
             }    
 
-            h = (unsigned int) fH;            
             s = (unsigned char) (fS * 255.f);            
         }
 
@@ -59,7 +48,6 @@ namespace core{
             i = (unsigned char) (((float) (r + g + b)) / 3.f);
             
             float fS;
-            float fH;
 
             float v1 = -(((sqrt(6.f) * (float) r) / 6.f) +
                     ((sqrt(6.f) * (float) g) / 6.f) +
@@ -67,17 +55,7 @@ namespace core{
 
             float v2 = ((float) r / sqrt(6.f)) - ((2.f * (float) g) / sqrt(6.f));
 
-            fH = atan2(v2, v1);
-            fH = radToDegrees(fH);
-
-            if (fH < -360.f)
-                fH = -360.f;
-
-            if (fH < 0.)
-                fH += 360.f;
-
-            if (fH > 360.f)
-                fH = 360.f;
+            h = fastHue(v1, v2);
             if (i != 0){
                 fS = 1.f - ((float)min / (float) i);
             }
@@ -91,7 +69,6 @@ namespace core{
                 fS = 0.f;
             }
 
-            h = (unsigned int) fH;
             s = (unsigned char) (fS * 255.f);
         }
 
@@ -188,7 +165,7 @@ namespace core{
             return image;
         }
 
-        uchar* OpenCvTools::simpleTsai(unsigned int* inputHSI, int height, int width, int channels) {
+        uchar* OpenCvTools::simpleTsai(const unsigned int* inputHSI, int height, int width, int channels) {
             uchar* retArr = 0;
             retArr = New uchar[height * width];
             if (retArr == 0){
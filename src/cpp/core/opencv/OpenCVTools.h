@@ -102,7 +102,7 @@ namespace core{
              * @return 
              * proportions of H and I channels values for each pixel
              */
-            static uchar* simpleTsai(unsigned int* inputHSI, int height, int width, int channels);
+            static uchar* simpleTsai(const unsigned int* inputHSI, int height, int width, int channels);
             /**
              * creates singel channel image from single channel byte array
              * @param input
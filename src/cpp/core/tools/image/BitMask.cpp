@@ -0,0 +1,205 @@
+#include "BitMask.h"
+#include "ImageView.h"
+#include "core/util/MemTracker.h"
+#if defined _OPENMP_MY
+#include <omp.h>
+#endif
+
+namespace core{
+    namespace tools{
+        namespace image{
+
+            using namespace cv;
+            using namespace std;
+
+            /**
+             * packs one row of 8bit values, last word is padded with zeros
+             */
+            inline void packRow(const uchar* src, uint64_t* dst, int cols){
+                int fullWords = cols / BIT_MASK_WORD_BITS;
+                for (int w = 0; w < fullWords; w++){
+                    uint64_t word = 0;
+                    for (int k = 0; k < BIT_MASK_WORD_BITS; k++){
+                        word |= (uint64_t)(src[k] != 0) << k;
+                    }
+                    dst[w] = word;
+                    src += BIT_MASK_WORD_BITS;
+                }
+                int rest = cols - fullWords * BIT_MASK_WORD_BITS;
+                if (rest > 0){
+                    uint64_t word = 0;
+                    for (int k = 0; k < rest; k++){
+                        word |= (uint64_t)(src[k] != 0) << k;
+                    }
+                    dst[fullWords] = word;
+                }
+            }
+
+            void BitMask::init(int rows, int cols){
+                this->rows = rows;
+                this->cols = cols;
+                wordsPerRow = (cols + BIT_MASK_WORD_BITS - 1) / BIT_MASK_WORD_BITS;
+                words.assign((size_t)rows * wordsPerRow, 0);
+            }
+
+            BitMask::BitMask(){
+                init(0, 0);
+            }
+
+            BitMask::BitMask(int rows, int cols){
+                init(rows, cols);
+            }
+
+            BitMask::BitMask(const Mat& mask) throw (SDException&){
+                fromMat(mask);
+            }
+
+            BitMask::BitMask(const uchar* values, int rows, int cols){
+                init(rows, cols);
+                int i;
+#if defined _OPENMP_MY
+                #pragma omp parallel for private(i)
+#endif
+                for (i = 0; i < rows; i++){
+                    packRow(values + (size_t)i * cols, row(i), cols);
+                }
+            }
+
+            BitMask::~BitMask(){
+            }
+
+            void BitMask::checkSize(const BitMask& other, const char* method) const throw (SDException&){
+                if (rows != other.rows || cols != other.cols){
+                    SDException exc(SHADOW_DIFFERENT_IMAGES_SIZES, method);
+                    throw exc;
+                }
+            }
+
+            void BitMask::resize(int rows, int cols){
+                init(rows, cols);
+            }
+
+            Mat* BitMask::toMat() const{
+                Mat* retImage = New Mat();
+                toMat(*retImage);
+                return retImage;
+            }
+
+            void BitMask::toMat(Mat& dst) const{
+                dst.create(rows, cols, CV_8UC1);
+                MaskView retView(dst);
+                int i;
+#if defined _OPENMP_MY
+                #pragma omp parallel for private(i)
+#endif
+                for (i = 0; i < rows; i++){
+                    const uint64_t* wordsRow = row(i);
+                    uchar* dstRow = retView.row(i);
+                    for (int j = 0; j < cols; j++){
+                        uint64_t bit = (wordsRow[j / BIT_MASK_WORD_BITS] >> (j % BIT_MASK_WORD_BITS)) & 1U;
+                        dstRow[j] = (uchar)(0U - (uint)bit);
+                    }
+                }
+            }
+
+            void BitMask::fromMat(const Mat& mask) throw (SDException&){
+                ConstMaskView maskView(mask);
+                init(maskView.getRows(), maskView.getCols());
+                int i;
+#if defined _OPENMP_MY
+                #pragma omp parallel for private(i)
+#endif
+                for (i = 0; i < rows; i++){
+                    packRow(maskView.row(i), row(i), cols);
+                }
+            }
+
+            int BitMask::getRows() const{
+                return rows;
+            }
+
+            int BitMask::getCols() const{
+                return cols;
+            }
+
+            int BitMask::getWordsPerRow() const{
+                return wordsPerRow;
+            }
+
+            uint64_t* BitMask::row(int row){
+                return &words[(size_t)row * wordsPerRow];
+            }
+
+            const uint64_t* BitMask::row(int row) const{
+                return &words[(size_t)row * wordsPerRow];
+            }
+
+            bool BitMask::get(int row, int col) const{
+                return (this->row(row)[col / BIT_MASK_WORD_BITS] >> (col % BIT_MASK_WORD_BITS)) & 1U;
+            }
+
+            void BitMask::set(int row, int col){
+                this->row(row)[col / BIT_MASK_WORD_BITS] |= (uint64_t)1U << (col % BIT_MASK_WORD_BITS);
+            }
+
+            void BitMask::clear(int row, int col){
+                this->row(row)[col / BIT_MASK_WORD_BITS] &= ~((uint64_t)1U << (col % BIT_MASK_WORD_BITS));
+            }
+
+            void BitMask::fill(bool value){
+                if (value == false || wordsPerRow == 0){
+                    words.assign(words.size(), 0);
+                    return;
+                }
+                int rest = cols % BIT_MASK_WORD_BITS;
+                uint64_t lastWord = (rest == 0) ? ~(uint64_t)0 : (((uint64_t)1U << rest) - 1);
+                for (int i = 0; i < rows; i++){
+                    uint64_t* wordsRow = row(i);
+                    for (int w = 0; w < wordsPerRow - 1; w++){
+                        wordsRow[w] = ~(uint64_t)0;
+                    }
+                    wordsRow[wordsPerRow - 1] = lastWord;
+                }
+            }
+
+            void BitMask::orWith(const BitMask& other) throw (SDException&){
+                checkSize(other, "BitMask::orWith");
+                size_t size = words.size();
+                uint64_t* dst = words.data();
+                const uint64_t* src = other.words.data();
+                for (size_t k = 0; k < size; k++){
+                    dst[k] |= src[k];
+                }
+            }
+
+            void BitMask::andWith(const BitMask& other) throw (SDException&){
+                checkSize(other, "BitMask::andWith");
+                size_t size = words.size();
+                uint64_t* dst = words.data();
+                const uint64_t* src = other.words.data();
+                for (size_t k = 0; k < size; k++){
+                    dst[k] &= src[k];
+                }
+            }
+
+            void BitMask::andNot(const BitMask& other) throw (SDException&){
+                checkSize(other, "BitMask::andNot");
+                size_t size = words.size();
+                uint64_t* dst = words.data();
+                const uint64_t* src = other.words.data();
+                for (size_t k = 0; k < size; k++){
+                    dst[k] &= ~src[k];
+                }
+            }
+
+            size_t BitMask::count() const{
+                size_t retVal = 0;
+                for (size_t k = 0; k < words.size(); k++){
+                    retVal += __builtin_popcountll(words[k]);
+                }
+                return retVal;
+            }
+
+        }
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef __BIT_MASK_H__
+#define __BIT_MASK_H__
+
+#include "opencv2/core/core.hpp"
+#include "typedefs.h"
+#include <vector>
+#include <stdint.h>
+
+#define BIT_MASK_WORD_BITS 64
+
+namespace core{
+    namespace tools{
+        namespace image{
+
+            /**
+             * Binary mask with one bit per pixel. Each row starts on new 64bit word,
+             * bits after last column are always zero, so boolean operations and
+             * counting work on whole words. Convert from and to Mat only when reading
+             * or writing images
+             */
+            class BitMask{
+            private:
+                int rows;
+                int cols;
+                int wordsPerRow;
+                std::vector<uint64_t> words;
+
+                void init(int rows, int cols);
+                void checkSize(const BitMask& other, const char* method) const throw (SDException&);
+            protected:
+            public:
+                /**
+                 * creates empty mask, use resize before use
+                 */
+                BitMask();
+                /**
+                 * creates mask with all bits cleared
+                 * @param rows
+                 * @param cols
+                 */
+                BitMask(int rows, int cols);
+                /**
+                 * packs 8bit single channel mask
+                 * @param mask
+                 * non zero pixels are set
+                 */
+                BitMask(const cv::Mat& mask) throw (SDException&);
+                /**
+                 * packs continuous array of values
+                 * @param values
+                 * rows * cols values in row major order, non zero values are set
+                 * @param rows
+                 * @param cols
+                 */
+                BitMask(const uchar* values, int rows, int cols);
+                virtual ~BitMask();
+
+                /**
+                 * changes size and clears all bits, word storage is reused
+                 * if it is large enough
+                 * @param rows
+                 * @param cols
+                 */
+                void resize(int rows, int cols);
+                /**
+                 * @return
+                 * single channel 8bit image, 255 for set bits, 0 otherwise. Caller is owner
+                 */
+                cv::Mat* toMat() const;
+                /**
+                 * unpacks mask to existing image, image is reallocated only if
+                 * its size or type differs
+                 * @param dst
+                 * single channel 8bit image, 255 for set bits, 0 otherwise
+                 */
+                void toMat(cv::Mat& dst) const;
+                /**
+                 * packs 8bit single channel mask into this mask, word storage is reused
+                 * if it is large enough
+                 * @param mask
+                 * non zero pixels are set
+                 */
+                void fromMat(const cv::Mat& mask) throw (SDException&);
+
+                int getRows() const;
+                int getCols() const;
+                int getWordsPerRow() const;
+                /**
+                 * @param row
+                 * @return
+                 * words of row, bit k of word w is column w * 64 + k
+                 */
+                uint64_t* row(int row);
+                const uint64_t* row(int row) const;
+
+                bool get(int row, int col) const;
+                void set(int row, int col);
+                void clear(int row, int col);
+                /**
+                 * sets or clears all bits
+                 * @param value
+                 */
+                void fill(bool value);
+
+                void orWith(const BitMask& other) throw (SDException&);
+                void andWith(const BitMask& other) throw (SDException&);
+                /**
+                 * clears bits which are set in other mask
+                 * @param other
+                 */
+                void andNot(const BitMask& other) throw (SDException&);
+                /**
+                 * @return
+                 * number of set bits
+                 */
+                size_t count() const;
+            };
+
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,357 @@
+#include "ConnectedComponents.h"
+#include "core/util/Config.h"
+#include "core/util/MemTracker.h"
+#include <climits>
+#include <atomic>
+#include <memory>
+#if defined _OPENMP_MY
+#include <omp.h>
+#endif
+
+namespace core{
+    namespace tools{
+        namespace image{
+
+            using namespace cv;
+            using namespace std;
+            using namespace core::util;
+
+            RegionStatistics::RegionStatistics(){
+                area = 0;
+                minX = UINT_MAX;
+                minY = UINT_MAX;
+                maxX = 0;
+                maxY = 0;
+                sumB = 0;
+                sumG = 0;
+                sumR = 0;
+            }
+
+            void RegionStatistics::add(uint x, uint y, const uchar* bgr){
+                area++;
+                minX = min(minX, x);
+                maxX = max(maxX, x);
+                minY = min(minY, y);
+                maxY = max(maxY, y);
+                if (bgr != 0){
+                    sumB += bgr[0];
+                    sumG += bgr[1];
+                    sumR += bgr[2];
+                }
+            }
+
+            void RegionStatistics::merge(const RegionStatistics& other){
+                area += other.area;
+                minX = min(minX, other.minX);
+                maxX = max(maxX, other.maxX);
+                minY = min(minY, other.minY);
+                maxY = max(maxY, other.maxY);
+                sumB += other.sumB;
+                sumG += other.sumG;
+                sumR += other.sumR;
+            }
+
+            Triple<float> RegionStatistics::getMeanBGR() const{
+                if (area == 0){
+                    return Triple<float>(0.f, 0.f, 0.f);
+                }
+                Triple<float> retVal((float)sumB / (float)area, (float)sumG / (float)area, (float)sumR / (float)area);
+                return retVal;
+            }
+
+            uint findRoot(vector<uint>& parents, uint label){
+                while (parents[label] != label){
+                    parents[label] = parents[parents[label]];
+                    label = parents[label];
+                }
+                return label;
+            }
+
+            void unite(vector<uint>& parents, uint first, uint second){
+                uint firstRoot = findRoot(parents, first);
+                uint secondRoot = findRoot(parents, second);
+                //smaller label is root, so roots are first occurrences of regions
+                if (firstRoot < secondRoot)
+                    parents[secondRoot] = firstRoot;
+                else if (secondRoot < firstRoot)
+                    parents[firstRoot] = secondRoot;
+            }
+
+            uint findRootAtomic(const atomic<uint>* parents, uint label){
+                uint parent = parents[label].load();
+                while (parent != label){
+                    label = parent;
+                    parent = parents[label].load();
+                }
+                return label;
+            }
+
+            /**
+             * roots are only linked to smaller roots, so concurrent unions can't make cycles
+             */
+            void uniteAtomic(atomic<uint>* parents, uint first, uint second){
+                while (true){
+                    first = findRootAtomic(parents, first);
+                    second = findRootAtomic(parents, second);
+                    if (first == second)
+                        return;
+                    if (first < second)
+                        swap(first, second);
+                    uint expected = first;
+                    if (parents[first].compare_exchange_strong(expected, second))
+                        return;
+                }
+            }
+
+            /**
+             * first labeling pass on rows [startRow, endRow), first row is not connected to rows above.
+             * Provisional labels are indexes in parents vector, parents[0] is background
+             */
+            void labelRows(const ConstMaskView& mask, uchar color, const LabelView& labels, int startRow, int endRow, 
+                            vector<uint>& parents){
+                int cols = mask.getCols();
+                for (int i = startRow; i < endRow; i++){
+                    const uchar* maskRow = mask.row(i);
+                    int* labelsRow = labels.row(i);
+                    const int* prevRow = (i > startRow) ? labels.row(i - 1) : 0;
+                    for (int j = 0; j < cols; j++){
+                        if (maskRow[j] != color){
+                            labelsRow[j] = 0;
+                            continue;
+                        }
+                        uint current = 0;
+                        if (j > 0 && labelsRow[j - 1] != 0)
+                            current = labelsRow[j - 1];
+                        if (prevRow != 0){
+                            int start = (j > 0) ? j - 1 : j;
+                            int end = (j < cols - 1) ? j + 1 : j;
+                            for (int k = start; k <= end; k++){
+                                uint neighbour = prevRow[k];
+                                if (neighbour == 0)
+                                    continue;
+                                if (current == 0)
+                                    current = neighbour;
+                                else if (neighbour != current)
+                                    unite(parents, current, neighbour);
+                            }
+                        }
+                        if (current == 0){
+                            current = (uint)parents.size();
+                            parents.push_back(current);
+                        }
+                        labelsRow[j] = current;
+                    }
+                }
+            }
+
+            ConnectedComponents::ConnectedComponents(){
+                string minPixelsStr = Config::getInstancePtr()->getPropertyValue("general.openMP.parallelLabelingMinPixels");
+                parallelMinPixels = (uint)atoi(minPixelsStr.c_str());
+            }
+
+            ConnectedComponents::~ConnectedComponents(){
+            }
+
+            void ConnectedComponents::label(const Mat& mask, uchar color, const Mat* colorImage) throw (SDException&){
+                ConstMaskView maskView(mask);
+                UNIQUE_PTR(ConstColorView) colorViewPtr;
+                if (colorImage != 0){
+                    colorViewPtr = UNIQUE_PTR(ConstColorView)(New ConstColorView(*colorImage));
+                    if (colorViewPtr->sameSize(maskView) == false){
+                        SDException exc(SHADOW_DIFFERENT_IMAGES_SIZES, "ConnectedComponents::label");
+                        throw exc;
+                    }
+                }
+                regions.clear();
+                labels.create(mask.rows, mask.cols, CV_32SC1);
+                LabelView labelsView(labels);
+#if defined _OPENMP_MY
+                if ((uint)(mask.rows * mask.cols) >= parallelMinPixels && omp_get_max_threads() > 1 && mask.rows > 1){
+                    labelParallel(maskView, color, colorViewPtr.get(), labelsView);
+                    return;
+                }
+#endif
+                labelSequential(maskView, color, colorViewPtr.get(), labelsView);
+            }
+
+            void ConnectedComponents::labelSequential(const ConstMaskView& mask, uchar color, const ConstColorView* colorImage,
+                                                    const LabelView& labelsView){
+                //label 0 is background
+                vector<uint> parents(1, 0);
+                labelRows(mask, color, labelsView, 0, mask.getRows(), parents);
+
+                //roots have smallest labels, so single sweep resolves final labels
+                uint provisionalCount = (uint)parents.size();
+                vector<uint> finalLabels(provisionalCount, 0);
+                for (uint k = 1; k < provisionalCount; k++){
+                    if (parents[k] == k){
+                        regions.push_back(RegionStatistics());
+                        finalLabels[k] = (uint)regions.size();
+                    }
+                    else{
+                        finalLabels[k] = finalLabels[findRoot(parents, k)];
+                    }
+                }
+
+                //second pass, final labels and statistics
+                for (int i = 0; i < mask.getRows(); i++){
+                    int* labelsRow = labelsView.row(i);
+                    const uchar* colorRow = (colorImage != 0) ? colorImage->row(i) : 0;
+                    for (int j = 0; j < mask.getCols(); j++){
+                        if (labelsRow[j] == 0)
+                            continue;
+                        uint finalLabel = finalLabels[labelsRow[j]];
+                        labelsRow[j] = finalLabel;
+                        regions[finalLabel - 1].add(j, i, colorRow ? colorRow + j * 3 : 0);
+                    }
+                }
+            }
+
+            void ConnectedComponents::labelParallel(const ConstMaskView& mask, uchar color, const ConstColorView* colorImage,
+                                                  const LabelView& labelsView){
+                int rows = mask.getRows();
+                int cols = mask.getCols();
+#if defined _OPENMP_MY
+                int stripCount = min(rows, omp_get_max_threads() * 4);
+#else
+                int stripCount = 1;
+#endif
+                int stripHeight = (rows + stripCount - 1) / stripCount;
+                stripCount = (rows + stripHeight - 1) / stripHeight;
+                vector< vector<uint> > stripParents(stripCount);
+                vector<uint> offsets(stripCount + 1, 0);
+
+                //strips are labeled independently, each with own label space
+                int s;
+#if defined _OPENMP_MY
+                #pragma omp parallel for private(s)
+#endif
+                for (s = 0; s < stripCount; s++){
+                    int startRow = s * stripHeight;
+                    int endRow = min(startRow + stripHeight, rows);
+                    stripParents[s].assign(1, 0);
+                    labelRows(mask, color, labelsView, startRow, endRow, stripParents[s]);
+                }
+
+                //global label is strip offset plus local label, so labels stay ordered by first occurrence
+                for (s = 0; s < stripCount; s++){
+                    offsets[s + 1] = offsets[s] + (uint)stripParents[s].size() - 1;
+                }
+                uint provisionalCount = offsets[stripCount] + 1;
+                vector< atomic<uint> > parents(provisionalCount);
+                parents[0].store(0);
+
+#if defined _OPENMP_MY
+                #pragma omp parallel for private(s)
+#endif
+                for (s = 0; s < stripCount; s++){
+                    vector<uint>& local = stripParents[s];
+                    uint offset = offsets[s];
+                    for (uint k = 1; k < local.size(); k++){
+                        parents[offset + k].store(offset + findRoot(local, k));
+                    }
+                    int startRow = s * stripHeight;
+                    int endRow = min(startRow + stripHeight, rows);
+                    for (int i = startRow; i < endRow; i++){
+                        int* labelsRow = labelsView.row(i);
+                        for (int j = 0; j < cols; j++){
+                            if (labelsRow[j] != 0)
+                                labelsRow[j] += offset;
+                        }
+                    }
+                }
+
+                //merge equivalences across strip borders
+#if defined _OPENMP_MY
+                #pragma omp parallel for private(s)
+#endif
+                for (s = 1; s < stripCount; s++){
+                    int row = s * stripHeight;
+                    const int* labelsRow = labelsView.row(row);
+                    const int* prevRow = labelsView.row(row - 1);
+                    for (int j = 0; j < cols; j++){
+                        if (labelsRow[j] == 0)
+                            continue;
+                        int start = (j > 0) ? j - 1 : j;
+                        int end = (j < cols - 1) ? j + 1 : j;
+                        for (int k = start; k <= end; k++){
+                            if (prevRow[k] != 0)
+                                uniteAtomic(&parents[0], labelsRow[j], prevRow[k]);
+                        }
+                    }
+                }
+
+                uint regionCount = 0;
+                vector<uint> finalLabels(provisionalCount, 0);
+                for (uint k = 1; k < provisionalCount; k++){
+                    uint root = findRootAtomic(&parents[0], k);
+                    if (root == k)
+                        finalLabels[k] = ++regionCount;
+                    else
+                        finalLabels[k] = finalLabels[root];
+                }
+
+                //statistics are collected per strip and provisional label, then merged
+                vector< vector<RegionStatistics> > stripStatistics(stripCount);
+#if defined _OPENMP_MY
+                #pragma omp parallel for private(s)
+#endif
+                for (s = 0; s < stripCount; s++){
+                    uint offset = offsets[s];
+                    vector<RegionStatistics>& statistics = stripStatistics[s];
+                    statistics.resize(offsets[s + 1] - offset + 1);
+                    int startRow = s * stripHeight;
+                    int endRow = min(startRow + stripHeight, rows);
+                    for (int i = startRow; i < endRow; i++){
+                        int* labelsRow = labelsView.row(i);
+                        const uchar* colorRow = (colorImage != 0) ? colorImage->row(i) : 0;
+                        for (int j = 0; j < cols; j++){
+                            if (labelsRow[j] == 0)
+                                continue;
+                            statistics[labelsRow[j] - offset].add(j, i, colorRow ? colorRow + j * 3 : 0);
+                            labelsRow[j] = finalLabels[labelsRow[j]];
+                        }
+                    }
+                }
+
+                regions.resize(regionCount);
+                for (s = 0; s < stripCount; s++){
+                    uint offset = offsets[s];
+                    vector<RegionStatistics>& statistics = stripStatistics[s];
+                    for (uint k = 1; k < statistics.size(); k++){
+                        regions[finalLabels[offset + k] - 1].merge(statistics[k]);
+                    }
+                }
+            }
+
+            const Mat& ConnectedComponents::getLabels() const{
+                return labels;
+            }
+
+            uint ConnectedComponents::getRegionCount() const{
+                return (uint)regions.size();
+            }
+
+            const RegionStatistics& ConnectedComponents::getRegion(uint label) const throw (SDException&){
+                if (label == 0 || label > regions.size()){
+                    SDException exc(SHADOW_OUT_OF_BOUNDS, "ConnectedComponents::getRegion");
+                    throw exc;
+                }
+                return regions[label - 1];
+            }
+
+            uint ConnectedComponents::getLargestRegion() const{
+                uint largest = 0;
+                uint largestArea = 0;
+                for (uint i = 0; i < regions.size(); i++){
+                    if (regions[i].area > largestArea){
+                        largestArea = regions[i].area;
+                        largest = i + 1;
+                    }
+                }
+                return largest;
+            }
+
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef __CONNECTED_COMPONENTS_H__
+#define __CONNECTED_COMPONENTS_H__
+
+#include "opencv2/core/core.hpp"
+#include "typedefs.h"
+#include "ImageView.h"
+#include <vector>
+#include <stdint.h>
+
+namespace core{
+    namespace tools{
+        namespace image{
+
+            /**
+             * statistics of single labeled region, collected during labeling
+             */
+            struct RegionStatistics{
+                uint area;
+                uint minX;
+                uint minY;
+                uint maxX;
+                uint maxY;
+                //sums of channel values, stays zero if color image is not passed to labeling
+                uint64_t sumB;
+                uint64_t sumG;
+                uint64_t sumR;
+
+                RegionStatistics();
+                /**
+                 * adds pixel to region
+                 * @param x
+                 * @param y
+                 * @param bgr
+                 * pointer to pixel in BGR image, can be null
+                 */
+                void add(uint x, uint y, const uchar* bgr);
+                /**
+                 * adds statistics of other part of same region
+                 * @param other
+                 */
+                void merge(const RegionStatistics& other);
+                /**
+                 * @return
+                 * mean B, G, R values of region pixels
+                 */
+                Triple<float> getMeanBGR() const;
+            };
+
+            /**
+             * Two pass connected component labeling with union find equivalences.
+             * Pixels are 8-connected. Labels start from 1 and are ordered by first
+             * occurrence in row major order, 0 is background.
+             * Images with at least general.openMP.parallelLabelingMinPixels pixels are
+             * labeled in horizontal strips on OpenMP threads, strip borders are merged
+             * with lock free union find. Result is same as of sequential labeling
+             */
+            class ConnectedComponents{
+            private:
+                cv::Mat labels;
+                std::vector<RegionStatistics> regions;
+                uint parallelMinPixels;
+
+                void labelSequential(const ConstMaskView& mask, uchar color, const ConstColorView* colorImage,
+                                     const LabelView& labelsView);
+                void labelParallel(const ConstMaskView& mask, uchar color, const ConstColorView* colorImage,
+                                   const LabelView& labelsView);
+
+                ConnectedComponents(const ConnectedComponents& other);
+                ConnectedComponents& operator=(const ConnectedComponents& other);
+            protected:
+            public:
+                ConnectedComponents();
+                virtual ~ConnectedComponents();
+
+                /**
+                 * labels regions of pixels which have value equals to color
+                 * @param mask
+                 * single channel 8bit image
+                 * @param color
+                 * value of pixels which are labeled
+                 * @param colorImage
+                 * optional BGR image of mask size, used for channel sums of regions
+                 */
+                void label(const cv::Mat& mask, uchar color, const cv::Mat* colorImage = 0) throw (SDException&);
+                /**
+                 * @return
+                 * label image, CV_32SC1, 0 for background
+                 */
+                const cv::Mat& getLabels() const;
+                /**
+                 * @return
+                 * number of found regions
+                 */
+                uint getRegionCount() const;
+                /**
+                 *
+                 * @param label
+                 * label of region, between 1 and getRegionCount()
+                 * @return
+                 * statistics of region
+                 */
+                const RegionStatistics& getRegion(uint label) const throw (SDException&);
+                /**
+                 * @return
+                 * label of region with largest area, 0 if there are no regions
+                 */
+                uint getLargestRegion() const;
+            };
+
+        }
+    }
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include <vector>
 #include "core/util/Matrix.h"
 #include "core/opencv/OpenCV2Tools.h"
+#include "core/tools/image/ImageContext.h"
 
 
 namespace core{
@@ -17,11 +18,26 @@ namespace core{
                 IImageParameteres(){}
                 virtual ~IImageParameteres(){}
                 
-                virtual core::util::Matrix<float>* getImageParameters(  const std::vector<const cv::Mat*>& images,
+                virtual core::util::Matrix<float>* getImageParameters(  ImageContext& context,
                                                                         int& rowDimension, int& pixelNum) throw (SDException&) = 0;
-                virtual core::util::Matrix<float>* getImageParameters(  const std::vector<const cv::Mat*>& images,
+                virtual core::util::Matrix<float>* getImageParameters(  ImageContext& context,
                                                                         const cv::Mat& maskImage,
                                                                         int& rowDimension, int& pixelNum) throw (SDException&) = 0;
+                /**
+                 * calculates parameters only for specified pixels
+                 * @param context
+                 * context of image
+                 * @param pixelIndices
+                 * indices of pixels (row * width + column), result rows are in same order
+                 * @param rowDimension
+                 * output, number of parameters per pixel
+                 * @param pixelNum
+                 * output, number of pixels in result
+                 * @return 
+                 */
+                virtual core::util::Matrix<float>* getImageParameters(  ImageContext& context,
+                                                                        const std::vector<uint>& pixelIndices,
+                                                                        int& rowDimension, int& pixelNum) throw (SDException&) = 0;
                 virtual void reset() = 0;                
             };
             
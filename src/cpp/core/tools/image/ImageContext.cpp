@@ -0,0 +1,154 @@
+#include "ImageContext.h"
+#include "ImageView.h"
+#include "core/opencv/OpenCV2Tools.h"
+#include "core/opencv/OpenCVTools.h"
+#include "core/util/MemTracker.h"
+
+namespace core{
+    namespace tools{
+        namespace image{
+
+            using namespace cv;
+            using namespace core::opencv;
+            using namespace core::opencv2;
+
+            ImageContext::ImageContext(const Mat& originalImage) throw (SDException&){
+                if (originalImage.data == 0 || originalImage.type() != CV_8UC3){
+                    SDException exc(SHADOW_INVALID_IMAGE_FORMAT, "ImageContext::ImageContext");
+                    throw exc;
+                }
+                this->originalImage = originalImage;
+                hsvImage = 0;
+                hlsImage = 0;
+                for (int i = 0; i < HSI_VARIANT_COUNT; i++){
+                    hsiImages[i] = 0;
+                }
+                lHistogram = 0;
+                skyCandidates = 0;
+            }
+
+            ImageContext::~ImageContext(){
+                if (hsvImage)
+                    Delete(hsvImage);
+                if (hlsImage)
+                    Delete(hlsImage);
+                for (int i = 0; i < HSI_VARIANT_COUNT; i++){
+                    if (hsiImages[i]){
+                        DeleteArr(hsiImages[i]);
+                    }
+                }
+                if (lHistogram){
+                    DeleteArr(lHistogram);
+                }
+                if (skyCandidates)
+                    Delete(skyCandidates);
+            }
+
+            const Mat& ImageContext::getOriginal() const{
+                return originalImage;
+            }
+
+            const Mat& ImageContext::getHSV() throw (SDException&){
+                if (hsvImage == 0){
+                    if (hlsImage == 0){
+                        OpenCV2Tools::convertToHSVAndHLS(&originalImage, hsvImage, hlsImage);
+                    }
+                    else{
+                        hsvImage = OpenCV2Tools::convertToHSV(&originalImage);
+                    }
+                    if (hsvImage == 0){
+                        SDException exc(SHADOW_NO_MEM, "ImageContext::getHSV");
+                        throw exc;
+                    }
+                }
+                return *hsvImage;
+            }
+
+            const Mat& ImageContext::getHLS() throw (SDException&){
+                if (hlsImage == 0){
+                    if (hsvImage == 0){
+                        OpenCV2Tools::convertToHSVAndHLS(&originalImage, hsvImage, hlsImage);
+                    }
+                    else{
+                        hlsImage = OpenCV2Tools::convertToHLS(&originalImage);
+                    }
+                    if (hlsImage == 0){
+                        SDException exc(SHADOW_NO_MEM, "ImageContext::getHLS");
+                        throw exc;
+                    }
+                }
+                return *hlsImage;
+            }
+
+            const uint* ImageContext::getHSI(HSI_VARIANT variant) throw (SDException&){
+                if (variant < 0 || variant >= HSI_VARIANT_COUNT){
+                    SDException exc(SHADOW_OUT_OF_BOUNDS, "ImageContext::getHSI");
+                    throw exc;
+                }
+                if (hsiImages[variant] == 0){
+                    int height, width, channels;
+                    if (variant == HSI_VARIANT_1){
+                        hsiImages[variant] = OpenCV2Tools::convertImagetoHSI(&originalImage, height, width,
+                                                                            channels, &OpenCvTools::RGBtoHSI_1);
+                    }
+                    else{
+                        hsiImages[variant] = OpenCV2Tools::convertImagetoHSI(&originalImage, height, width,
+                                                                            channels, &OpenCvTools::RGBtoHSI_2);
+                    }
+                    if (hsiImages[variant] == 0){
+                        SDException exc(SHADOW_NO_MEM, "ImageContext::getHSI");
+                        throw exc;
+                    }
+                }
+                return hsiImages[variant];
+            }
+
+            const uint* ImageContext::getLHistogram() throw (SDException&){
+                if (lHistogram == 0){
+                    ConstColorView hlsView(getHLS());
+                    lHistogram = New uint[HISTOGRAM_SIZE];
+                    memset(lHistogram, 0, HISTOGRAM_SIZE * sizeof(uint));
+                    for (int i = 0; i < hlsView.getRows(); i++){
+                        const uchar* row = hlsView.row(i);
+                        for (int j = 0; j < hlsView.getCols(); j++){
+                            lHistogram[row[j * 3 + 1]]++;
+                        }
+                    }
+                }
+                return lHistogram;
+            }
+
+            bool ImageContext::hasSkyCandidates() const{
+                return skyCandidates != 0;
+            }
+
+            const Mat& ImageContext::getSkyCandidates() const throw (SDException&){
+                if (skyCandidates == 0){
+                    SDException exc(SHADOW_NULL_POINTER, "ImageContext::getSkyCandidates");
+                    throw exc;
+                }
+                return *skyCandidates;
+            }
+
+            void ImageContext::setSkyCandidates(Mat* candidates) throw (SDException&){
+                if (candidates == 0 || candidates->rows != originalImage.rows ||
+                    candidates->cols != originalImage.cols || candidates->channels() != 1){
+                    SDException exc(SHADOW_DIFFERENT_IMAGES_SIZES, "ImageContext::setSkyCandidates");
+                    throw exc;
+                }
+                if (skyCandidates)
+                    Delete(skyCandidates);
+                skyCandidates = candidates;
+            }
+
+            int ImageContext::getWidth() const{
+                return originalImage.cols;
+            }
+
+            int ImageContext::getHeight() const{
+                return originalImage.rows;
+            }
+
+        }
+    }
+}
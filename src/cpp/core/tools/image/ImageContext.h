@@ -0,0 +1,107 @@
+#ifndef __IMAGE_CONTEXT_H__
+#define __IMAGE_CONTEXT_H__
+
+#include "opencv2/core/core.hpp"
+#include "typedefs.h"
+
+#define HISTOGRAM_SIZE 256
+
+namespace core{
+    namespace tools{
+        namespace image{
+
+            /**
+             * variants of HSI conversion, see OpenCvTools::RGBtoHSI_1 and OpenCvTools::RGBtoHSI_2
+             */
+            enum HSI_VARIANT{
+                HSI_VARIANT_1 = 0,
+                HSI_VARIANT_2,
+                HSI_VARIANT_COUNT
+            };
+
+            /**
+             * Per image cache shared by all processing stages. Derived images are calculated
+             * on first request and kept until context is destroyed, so each conversion is done
+             * once per image. Returned values are owned by context.
+             * Not thread safe, stages using same context should run one after other.
+             */
+            class ImageContext{
+            private:
+                //header only, shares data with image passed to constructor
+                cv::Mat originalImage;
+                cv::Mat* hsvImage;
+                cv::Mat* hlsImage;
+                uint* hsiImages[HSI_VARIANT_COUNT];
+                uint* lHistogram;
+                cv::Mat* skyCandidates;
+
+                ImageContext();
+                ImageContext(const ImageContext& other);
+                ImageContext& operator=(const ImageContext& other);
+            protected:
+            public:
+                /**
+                 *
+                 * @param originalImage
+                 * BGR image, 8bit three channels. Image data must stay valid during context lifetime
+                 */
+                ImageContext(const cv::Mat& originalImage) throw (SDException&);
+                virtual ~ImageContext();
+
+                /**
+                 * @return
+                 * original BGR image
+                 */
+                const cv::Mat& getOriginal() const;
+                /**
+                 * HSV and HLS are calculated together on first call,
+                 * because every stage which needs HSV needs HLS as well
+                 * @return
+                 * image in HSV format
+                 */
+                const cv::Mat& getHSV() throw (SDException&);
+                /**
+                 * calculated together with HSV, same as getHSV
+                 * @return
+                 * image in HLS format
+                 */
+                const cv::Mat& getHLS() throw (SDException&);
+                /**
+                 *
+                 * @param variant
+                 * HSI conversion variant
+                 * @return
+                 * uint array where three values represents one pixel in H, S, I order
+                 */
+                const uint* getHSI(HSI_VARIANT variant) throw (SDException&);
+                /**
+                 * @return
+                 * histogram of HLS lightness channel, HISTOGRAM_SIZE bins
+                 */
+                const uint* getLHistogram() throw (SDException&);
+                /**
+                 * @return
+                 * true if sky candidates were set
+                 */
+                bool hasSkyCandidates() const;
+                /**
+                 * @return
+                 * single channel image, 255 for sky candidate pixels, 0 otherwise
+                 */
+                const cv::Mat& getSkyCandidates() const throw (SDException&);
+                /**
+                 * stores sky candidates, calculated by sky detection
+                 * @param candidates
+                 * single channel image, context takes ownership
+                 */
+                void setSkyCandidates(cv::Mat* candidates) throw (SDException&);
+
+                int getWidth() const;
+                int getHeight() const;
+            };
+
+        }
+    }
+}
+
+#endif
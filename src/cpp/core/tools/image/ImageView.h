@@ -0,0 +1,119 @@
+#ifndef __IMAGE_VIEW_H__
+#define __IMAGE_VIEW_H__
+
+#include "opencv2/core/core.hpp"
+#include "typedefs.h"
+#include <type_traits>
+
+namespace core{
+    namespace tools{
+        namespace image{
+
+            /**
+             * Typed view of image data with channel count known at compile time.
+             * Gives stride aware row and pixel pointers, so pixel loops don't go through
+             * checked accessors and can be vectorized. Format is checked once on construction,
+             * bounds are checked only in debug build.
+             * Use const element type (ImageView<const uchar, 3>) for read only access
+             */
+            template<typename T, int Channels> class ImageView{
+            private:
+                typedef typename std::remove_const<T>::type ValueType;
+                typedef typename std::conditional<std::is_const<T>::value, const cv::Mat, cv::Mat>::type MatType;
+                typedef typename std::conditional<std::is_const<T>::value, const uchar, uchar>::type ByteType;
+
+                ByteType* data;
+                size_t step;
+                int rows;
+                int cols;
+
+                inline void checkRow(int row) const throw (SDException&){
+#ifdef _DEBUG
+                    if (row < 0 || row >= rows){
+                        SDException exc(SHADOW_OUT_OF_BOUNDS, "ImageView row");
+                        throw exc;
+                    }
+#endif
+                }
+
+                inline void checkCol(int col) const throw (SDException&){
+#ifdef _DEBUG
+                    if (col < 0 || col >= cols){
+                        SDException exc(SHADOW_OUT_OF_BOUNDS, "ImageView col");
+                        throw exc;
+                    }
+#endif
+                }
+            protected:
+            public:
+                static constexpr int channels = Channels;
+
+                /**
+                 *
+                 * @param image
+                 * image which depth matches T and has Channels channels, must live longer than view
+                 */
+                ImageView(MatType& image) throw (SDException&){
+                    if (image.data == 0 || image.depth() != cv::DataType<ValueType>::depth ||
+                        image.channels() != Channels){
+                        SDException exc(SHADOW_INVALID_IMAGE_FORMAT, "ImageView::ImageView");
+                        throw exc;
+                    }
+                    data = image.data;
+                    step = image.step;
+                    rows = image.rows;
+                    cols = image.cols;
+                }
+
+                /**
+                 * @param row
+                 * @return
+                 * pointer to first element of row
+                 */
+                inline T* row(int row) const{
+                    checkRow(row);
+                    return (T*)(data + row * step);
+                }
+
+                /**
+                 * @param row
+                 * @param col
+                 * @return
+                 * pointer to first channel of pixel
+                 */
+                inline T* pixel(int row, int col) const{
+                    checkCol(col);
+                    return this->row(row) + col * Channels;
+                }
+
+                inline int getRows() const{
+                    return rows;
+                }
+
+                inline int getCols() const{
+                    return cols;
+                }
+
+                /**
+                 * @return
+                 * true if other view has same number of rows and columns
+                 */
+                template<typename U, int C> bool sameSize(const ImageView<U, C>& other) const{
+                    return rows == other.getRows() && cols == other.getCols();
+                }
+            };
+
+            //single channel 8bit masks
+            typedef ImageView<const uchar, 1> ConstMaskView;
+            typedef ImageView<uchar, 1> MaskView;
+            //three channel 8bit images, BGR, HSV or HLS
+            typedef ImageView<const uchar, 3> ConstColorView;
+            //label images of ConnectedComponents
+            typedef ImageView<const int, 1> ConstLabelView;
+            typedef ImageView<int, 1> LabelView;
+
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,212 @@
+#include "Morphology.h"
+#include "ImageView.h"
+#include <vector>
+#include <algorithm>
+#if defined _OPENMP_MY
+#include <omp.h>
+#endif
+
+namespace core{
+    namespace tools{
+        namespace image{
+
+            using namespace cv;
+            using namespace std;
+
+            struct MinOp{
+                static inline uchar neutral(){
+                    return 255;
+                }
+
+                static inline uchar apply(uchar a, uchar b){
+                    return (a < b) ? a : b;
+                }
+            };
+
+            struct MaxOp{
+                static inline uchar neutral(){
+                    return 0;
+                }
+
+                static inline uchar apply(uchar a, uchar b){
+                    return (a > b) ? a : b;
+                }
+            };
+
+            /**
+             * padded length of line with n values for element of size k,
+             * multiple of k so van Herk blocks are aligned
+             */
+            inline int paddedLength(int n, int k){
+                return ((n + k - 1 + k - 1) / k) * k;
+            }
+
+            /**
+             * van Herk / Gil-Werman pass on single row. Padded, prefix and suffix
+             * buffers must have paddedLength(n, k) values
+             */
+            template<typename Op> void runningRow(const uchar* src, uchar* dst, int n, int k,
+                                                  uchar* padded, uchar* prefix, uchar* suffix){
+                int anchor = k / 2;
+                int length = paddedLength(n, k);
+                fill(padded, padded + anchor, Op::neutral());
+                copy(src, src + n, padded + anchor);
+                fill(padded + anchor + n, padded + length, Op::neutral());
+                for (int block = 0; block < length; block += k){
+                    prefix[block] = padded[block];
+                    for (int j = 1; j < k; j++){
+                        prefix[block + j] = Op::apply(prefix[block + j - 1], padded[block + j]);
+                    }
+                    suffix[block + k - 1] = padded[block + k - 1];
+                    for (int j = k - 2; j >= 0; j--){
+                        suffix[block + j] = Op::apply(suffix[block + j + 1], padded[block + j]);
+                    }
+                }
+                for (int x = 0; x < n; x++){
+                    dst[x] = Op::apply(suffix[x], prefix[x + k - 1]);
+                }
+            }
+
+            Morphology::Morphology(){
+            }
+
+            Morphology::~Morphology(){
+            }
+
+            template<typename Op> void Morphology::horizontalPass(const ConstMaskView& src, const MaskView& dst, int k){
+                int rows = src.getRows();
+                int cols = src.getCols();
+                int length = paddedLength(cols, k);
+#if defined _OPENMP_MY
+                int stripCount = min(rows, omp_get_max_threads());
+#else
+                int stripCount = 1;
+#endif
+                stripCount = max(stripCount, 1);
+                int stripHeight = (rows + stripCount - 1) / stripCount;
+                rowBuffers.resize((size_t)length * 3 * stripCount);
+                int s;
+#if defined _OPENMP_MY
+                #pragma omp parallel for private(s)
+#endif
+                for (s = 0; s < stripCount; s++){
+                    uchar* padded = &rowBuffers[(size_t)length * 3 * s];
+                    uchar* prefix = padded + length;
+                    uchar* suffix = prefix + length;
+                    int endRow = min((s + 1) * stripHeight, rows);
+                    for (int i = s * stripHeight; i < endRow; i++){
+                        runningRow<Op>(src.row(i), dst.row(i), cols, k, padded, prefix, suffix);
+                    }
+                }
+            }
+
+            /**
+             * van Herk / Gil-Werman on columns, rows of prefix and suffix
+             * buffers are processed whole, so inner loops run along rows
+             */
+            template<typename Op> void Morphology::verticalPass(const MaskView& image, int k){
+                int rows = image.getRows();
+                int cols = image.getCols();
+                int anchor = k / 2;
+                int length = paddedLength(rows, k);
+                prefix.resize((size_t)length * cols);
+                suffix.resize((size_t)length * cols);
+                int blockCount = length / k;
+                int b;
+#if defined _OPENMP_MY
+                #pragma omp parallel for private(b)
+#endif
+                for (b = 0; b < blockCount; b++){
+                    int block = b * k;
+                    for (int j = 0; j < k; j++){
+                        int srcRow = block + j - anchor;
+                        uchar* prefixRow = &prefix[(size_t)(block + j) * cols];
+                        if (srcRow < 0 || srcRow >= rows){
+                            if (j == 0)
+                                fill(prefixRow, prefixRow + cols, Op::neutral());
+                            else
+                                copy(prefixRow - cols, prefixRow, prefixRow);
+                            continue;
+                        }
+                        const uchar* srcData = image.row(srcRow);
+                        if (j == 0){
+                            copy(srcData, srcData + cols, prefixRow);
+                        }
+                        else{
+                            const uchar* prevRow = prefixRow - cols;
+                            for (int x = 0; x < cols; x++){
+                                prefixRow[x] = Op::apply(prevRow[x], srcData[x]);
+                            }
+                        }
+                    }
+                    for (int j = k - 1; j >= 0; j--){
+                        int srcRow = block + j - anchor;
+                        uchar* suffixRow = &suffix[(size_t)(block + j) * cols];
+                        if (srcRow < 0 || srcRow >= rows){
+                            if (j == k - 1)
+                                fill(suffixRow, suffixRow + cols, Op::neutral());
+                            else
+                                copy(suffixRow + cols, suffixRow + 2 * cols, suffixRow);
+                            continue;
+                        }
+                        const uchar* srcData = image.row(srcRow);
+                        if (j == k - 1){
+                            copy(srcData, srcData + cols, suffixRow);
+                        }
+                        else{
+                            const uchar* nextRow = suffixRow + cols;
+                            for (int x = 0; x < cols; x++){
+                                suffixRow[x] = Op::apply(nextRow[x], srcData[x]);
+                            }
+                        }
+                    }
+                }
+
+                int i;
+#if defined _OPENMP_MY
+                #pragma omp parallel for private(i)
+#endif
+                for (i = 0; i < rows; i++){
+                    const uchar* suffixRow = &suffix[(size_t)i * cols];
+                    const uchar* prefixRow = &prefix[(size_t)(i + k - 1) * cols];
+                    uchar* dstRow = image.row(i);
+                    for (int x = 0; x < cols; x++){
+                        dstRow[x] = Op::apply(suffixRow[x], prefixRow[x]);
+                    }
+                }
+            }
+
+            template<typename Op> void Morphology::morphology(const Mat& src, Mat& dst, int width, int height){
+                ConstMaskView srcView(src);
+                if (&src != &dst)
+                    dst.create(src.rows, src.cols, CV_8UC1);
+                MaskView dstView(dst);
+                if (width > 1)
+                    horizontalPass<Op>(srcView, dstView, width);
+                else if (&src != &dst)
+                    src.copyTo(dst);
+                if (height > 1)
+                    verticalPass<Op>(dstView, height);
+            }
+
+            void Morphology::erode(const Mat& src, Mat& dst, int width, int height) throw (SDException&){
+                morphology<MinOp>(src, dst, width, height);
+            }
+
+            void Morphology::dilate(const Mat& src, Mat& dst, int width, int height) throw (SDException&){
+                morphology<MaxOp>(src, dst, width, height);
+            }
+
+            void Morphology::open(const Mat& src, Mat& dst, int width, int height) throw (SDException&){
+                erode(src, dst, width, height);
+                dilate(dst, dst, width, height);
+            }
+
+            void Morphology::close(const Mat& src, Mat& dst, int width, int height) throw (SDException&){
+                dilate(src, dst, width, height);
+                erode(dst, dst, width, height);
+            }
+
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef __MORPHOLOGY_H__
+#define __MORPHOLOGY_H__
+
+#include "opencv2/core/core.hpp"
+#include "typedefs.h"
+#include "ImageView.h"
+#include <vector>
+
+namespace core{
+    namespace tools{
+        namespace image{
+
+            /**
+             * Erosion and dilation of single channel 8bit images with rectangular structuring
+             * element. Uses van Herk / Gil-Werman running min / max separately on rows and
+             * columns, so cost per pixel doesn't depend on element size. Anchor is element center
+             * and pixels outside image don't change result, same as OpenCV erode / dilate with
+             * default border. Both passes are row parallel. Scratch buffers are kept in
+             * instance and reused by following calls
+             */
+            class Morphology{
+            private:
+                //padded, prefix and suffix rows of horizontal pass, one set per strip
+                std::vector<uchar> rowBuffers;
+                //prefix and suffix images of vertical pass
+                std::vector<uchar> prefix;
+                std::vector<uchar> suffix;
+
+                template<typename Op> void horizontalPass(const ConstMaskView& src, const MaskView& dst, int k);
+                template<typename Op> void verticalPass(const MaskView& image, int k);
+                template<typename Op> void morphology(const cv::Mat& src, cv::Mat& dst, int width, int height);
+            protected:
+            public:
+                Morphology();
+                virtual ~Morphology();
+
+                /**
+                 * @param src
+                 * single channel 8bit image
+                 * @param dst
+                 * output, can be same as src
+                 * @param width
+                 * structuring element width
+                 * @param height
+                 * structuring element height
+                 */
+                void erode(const cv::Mat& src, cv::Mat& dst, int width, int height) throw (SDException&);
+                void dilate(const cv::Mat& src, cv::Mat& dst, int width, int height) throw (SDException&);
+                /**
+                 * erosion followed by dilation, removes foreground smaller than element
+                 */
+                void open(const cv::Mat& src, cv::Mat& dst, int width, int height) throw (SDException&);
+                /**
+                 * dilation followed by erosion, fills background gaps smaller than element
+                 */
+                void close(const cv::Mat& src, cv::Mat& dst, int width, int height) throw (SDException&);
+            };
+
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,144 @@
+#include "TsaiMask.h"
+#include "ImageView.h"
+#include "core/opencv/OpenCVTools.h"
+#include "core/util/MemTracker.h"
+#include <vector>
+#include <cfloat>
+#include <algorithm>
+#if defined _OPENMP_MY
+#include <omp.h>
+#endif
+
+namespace core{
+    namespace tools{
+        namespace image{
+
+            using namespace cv;
+            using namespace std;
+            using namespace core::opencv;
+
+            /**
+             * same ratio and scaling as OpenCvTools::simpleTsai
+             */
+            inline uchar tsaiRatio(uint h, uchar i){
+                float segment = 360.f / 255.f;
+                float ratio = (float)h / ((float)i + 1.f);
+                ratio /= segment;
+                return (uchar)ratio;
+            }
+
+            TsaiMask::TsaiMask(){
+            }
+
+            TsaiMask::~TsaiMask(){
+            }
+
+            void TsaiMask::detect(const Mat& image, BitMask& result) throw (SDException&){
+                ConstColorView imageView(image);
+                int rows = imageView.getRows();
+                int cols = imageView.getCols();
+                ratios.resize((size_t)rows * cols * HSI_VARIANT_COUNT);
+
+#if defined _OPENMP_MY
+                int stripCount = min(rows, omp_get_max_threads());
+#else
+                int stripCount = 1;
+#endif
+                stripCount = max(stripCount, 1);
+                int stripHeight = (rows + stripCount - 1) / stripCount;
+                stripHistograms.assign((size_t)stripCount * HSI_VARIANT_COUNT * HISTOGRAM_SIZE, 0);
+
+                //first pass, ratios and histograms, each strip counts in own histograms
+                int s;
+#if defined _OPENMP_MY
+                #pragma omp parallel for private(s)
+#endif
+                for (s = 0; s < stripCount; s++){
+                    uint* histogram1 = &stripHistograms[(size_t)s * HSI_VARIANT_COUNT * HISTOGRAM_SIZE];
+                    uint* histogram2 = histogram1 + HISTOGRAM_SIZE;
+                    int startRow = s * stripHeight;
+                    int endRow = min(startRow + stripHeight, rows);
+                    for (int i = startRow; i < endRow; i++){
+                        const uchar* pixel = imageView.row(i);
+                        uchar* ratiosRow = &ratios[(size_t)i * cols * HSI_VARIANT_COUNT];
+                        for (int j = 0; j < cols; j++){
+                            uint h;
+                            uchar sat, intensity;
+                            OpenCvTools::RGBtoHSI_1(pixel[2], pixel[1], pixel[0], h, sat, intensity);
+                            uchar ratio1 = tsaiRatio(h, intensity);
+                            OpenCvTools::RGBtoHSI_2(pixel[2], pixel[1], pixel[0], h, sat, intensity);
+                            uchar ratio2 = tsaiRatio(h, intensity);
+                            ratiosRow[0] = ratio1;
+                            ratiosRow[1] = ratio2;
+                            histogram1[ratio1]++;
+                            histogram2[ratio2]++;
+                            pixel += ConstColorView::channels;
+                            ratiosRow += HSI_VARIANT_COUNT;
+                        }
+                    }
+                }
+
+                uint histogram1[HISTOGRAM_SIZE] = {0};
+                uint histogram2[HISTOGRAM_SIZE] = {0};
+                for (s = 0; s < stripCount; s++){
+                    const uint* stripHistogram = &stripHistograms[(size_t)s * HSI_VARIANT_COUNT * HISTOGRAM_SIZE];
+                    for (int k = 0; k < HISTOGRAM_SIZE; k++){
+                        histogram1[k] += stripHistogram[k];
+                        histogram2[k] += stripHistogram[HISTOGRAM_SIZE + k];
+                    }
+                }
+                size_t pixelCount = (size_t)rows * cols;
+                uchar threshold1 = otsuThreshold(histogram1, pixelCount);
+                uchar threshold2 = otsuThreshold(histogram2, pixelCount);
+
+                //second pass, OR of both thresholded ratios packed to words
+                result.resize(rows, cols);
+                int i;
+#if defined _OPENMP_MY
+                #pragma omp parallel for private(i)
+#endif
+                for (i = 0; i < rows; i++){
+                    const uchar* ratiosRow = &ratios[(size_t)i * cols * HSI_VARIANT_COUNT];
+                    uint64_t* maskRow = result.row(i);
+                    for (int j = 0; j < cols; j++){
+                        uint64_t bit = (ratiosRow[0] > threshold1) | (ratiosRow[1] > threshold2);
+                        maskRow[j / BIT_MASK_WORD_BITS] |= bit << (j % BIT_MASK_WORD_BITS);
+                        ratiosRow += HSI_VARIANT_COUNT;
+                    }
+                }
+            }
+
+            uchar TsaiMask::otsuThreshold(const uint* histogram, size_t pixelCount){
+                if (pixelCount == 0)
+                    return 0;
+                double scale = 1. / (double)pixelCount;
+                double mu = 0.;
+                for (int k = 0; k < HISTOGRAM_SIZE; k++){
+                    mu += k * (double)histogram[k];
+                }
+                mu *= scale;
+
+                double mu1 = 0., q1 = 0.;
+                double maxSigma = 0.;
+                int threshold = 0;
+                for (int k = 0; k < HISTOGRAM_SIZE; k++){
+                    double pk = histogram[k] * scale;
+                    mu1 *= q1;
+                    q1 += pk;
+                    double q2 = 1. - q1;
+                    if (min(q1, q2) < FLT_EPSILON || max(q1, q2) > 1. - FLT_EPSILON)
+                        continue;
+                    mu1 = (mu1 + k * pk) / q1;
+                    double mu2 = (mu - q1 * mu1) / q2;
+                    double sigma = q1 * q2 * (mu1 - mu2) * (mu1 - mu2);
+                    if (sigma > maxSigma){
+                        maxSigma = sigma;
+                        threshold = k;
+                    }
+                }
+                return (uchar)threshold;
+            }
+
+        }
+    }
+}
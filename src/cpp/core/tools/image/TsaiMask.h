@@ -0,0 +1,58 @@
+#ifndef __TSAI_MASK_H__
+#define __TSAI_MASK_H__
+
+#include "opencv2/core/core.hpp"
+#include "typedefs.h"
+#include "BitMask.h"
+#include "ImageContext.h"
+#include <vector>
+
+namespace core{
+    namespace tools{
+        namespace image{
+
+            /**
+             * Fused Tsai shadow detection. Both HSI variants H / (I + 1) ratios are calculated
+             * directly from BGR pixels in one pass which also fills both ratio histograms,
+             * Otsu thresholds are found from histograms and second pass packs OR of both
+             * thresholded ratios into bit mask. Result is same as simpleTsai, Otsu binarization
+             * and joinTwo done for each variant, without HSI arrays and intermediate images
+             */
+            class TsaiMask{
+            private:
+                //two bytes per pixel, ratio of first and second HSI variant
+                std::vector<uchar> ratios;
+                //HSI_VARIANT_COUNT histograms per strip
+                std::vector<uint> stripHistograms;
+            protected:
+            public:
+                TsaiMask();
+                virtual ~TsaiMask();
+
+                /**
+                 * buffers are kept between calls, so same object processes series of
+                 * images without new allocations
+                 * @param image
+                 * BGR image, 8bit three channels
+                 * @param result
+                 * output, resized to image size. Bits are set for pixels which are over
+                 * Otsu threshold in any HSI variant
+                 */
+                void detect(const cv::Mat& image, BitMask& result) throw (SDException&);
+                /**
+                 * same threshold as OpenCV THRESH_OTSU for 8bit images
+                 * @param histogram
+                 * HISTOGRAM_SIZE bins
+                 * @param pixelCount
+                 * sum of histogram bins
+                 * @return
+                 * threshold, pixels with value greater than threshold are foreground
+                 */
+                static uchar otsuThreshold(const uint* histogram, size_t pixelCount);
+            };
+
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,317 @@
+#include "BinaryTrainingSet.h"
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "core/util/raii/RAIIS.h"
+
+namespace core{
+    namespace tools{
+        namespace svm{
+
+            using namespace std;
+            using namespace core::util::raii;
+
+            size_t featureSize(uint32_t featureType){
+                return (featureType == TRAINING_SET_UINT8) ? sizeof(unsigned char) : sizeof(float);
+            }
+
+            BinaryTrainingSetWriter::BinaryTrainingSetWriter(){
+                featureType = TRAINING_SET_FLOAT32;
+                memset(&header, 0, sizeof(header));
+            }
+
+            BinaryTrainingSetWriter::~BinaryTrainingSetWriter(){
+                if (file.is_open()){
+                    file.close();
+                }
+            }
+
+            void BinaryTrainingSetWriter::open(const string& filePath, TRAINING_SET_FEATURE_TYPE featureType) throw (SDException&){
+                this->filePath = filePath;
+                this->featureType = featureType;
+                memset(&header, 0, sizeof(header));
+                strcpy(header.magic, BINARY_TRAINING_SET_MAGIC);
+                header.version = BINARY_TRAINING_SET_VERSION;
+                header.featureType = featureType;
+                labels.clear();
+                minValues.clear();
+                maxValues.clear();
+                //uint8 features are written to final file only when ranges are known
+                if (featureType == TRAINING_SET_UINT8){
+                    featurePath = filePath + ".features";
+                    file.open(featurePath.c_str(), fstream::out | fstream::trunc | fstream::binary);
+                }
+                else{
+                    file.open(filePath.c_str(), fstream::out | fstream::trunc | fstream::binary);
+                    file.write((const char*)&header, sizeof(header));
+                }
+                if (file.is_open() == false){
+                    SDException exc(SHADOW_WRITE_UNABLE, "BinaryTrainingSetWriter::open");
+                    throw exc;
+                }
+            }
+
+            void BinaryTrainingSetWriter::addRows(const float* rows, size_t count, int rowDimension) throw (SDException&){
+                if (count == 0){
+                    return;
+                }
+                uint32_t dimension = rowDimension - 1;
+                if (labels.empty()){
+                    header.dimension = dimension;
+                }
+                else if (header.dimension != dimension){
+                    SDException exc(SHADOW_OUT_OF_BOUNDS, "BinaryTrainingSetWriter::addRows");
+                    throw exc;
+                }
+                for (size_t i = 0; i < count; i++){
+                    const float* row = rows + i * rowDimension;
+                    float label = row[0];
+                    if (label < 0.f || label > 255.f || label != floorf(label)){
+                        SDException exc(SHADOW_OUT_OF_BOUNDS, "BinaryTrainingSetWriter::addRows");
+                        throw exc;
+                    }
+                    const float* values = row + 1;
+                    if (labels.empty()){
+                        minValues.assign(values, values + dimension);
+                        maxValues.assign(values, values + dimension);
+                    }
+                    for (uint32_t j = 0; j < dimension; j++){
+                        if (values[j] < minValues[j])
+                            minValues[j] = values[j];
+                        if (values[j] > maxValues[j])
+                            maxValues[j] = values[j];
+                    }
+                    labels.push_back((unsigned char)label);
+                    file.write((const char*)values, dimension * sizeof(float));
+                }
+                if (file.fail()){
+                    SDException exc(SHADOW_WRITE_UNABLE, "BinaryTrainingSetWriter::addRows");
+                    throw exc;
+                }
+            }
+
+            void BinaryTrainingSetWriter::writeQuantized() throw (SDException&){
+                file.close();
+                fstream input;
+                input.open(featurePath.c_str(), fstream::in | fstream::binary);
+                FileRaii inRaii(&input);
+                file.open(filePath.c_str(), fstream::out | fstream::trunc | fstream::binary);
+                if (input.is_open() == false || file.is_open() == false){
+                    SDException exc(SHADOW_WRITE_UNABLE, "BinaryTrainingSetWriter::writeQuantized");
+                    throw exc;
+                }
+                uint32_t dimension = header.dimension;
+                vector<float> steps(dimension);
+                for (uint32_t j = 0; j < dimension; j++){
+                    steps[j] = (maxValues[j] - minValues[j]) / 255.f;
+                }
+                file.write((const char*)&header, sizeof(header));
+                if (dimension > 0){
+                    file.write((const char*)&minValues[0], dimension * sizeof(float));
+                    file.write((const char*)&steps[0], dimension * sizeof(float));
+                }
+                vector<float> row(dimension);
+                vector<unsigned char> quantized(dimension);
+                for (uint64_t i = 0; i < header.rows && dimension > 0; i++){
+                    input.read((char*)&row[0], dimension * sizeof(float));
+                    for (uint32_t j = 0; j < dimension; j++){
+                        float q = (steps[j] > 0.f) ? (row[j] - minValues[j]) / steps[j] : 0.f;
+                        q = floorf(q + 0.5f);
+                        if (q > 255.f)
+                            q = 255.f;
+                        quantized[j] = (unsigned char)q;
+                    }
+                    file.write((const char*)&quantized[0], dimension);
+                }
+                if (input.fail()){
+                    SDException exc(SHADOW_READ_UNABLE, "BinaryTrainingSetWriter::writeQuantized");
+                    throw exc;
+                }
+                input.close();
+                remove(featurePath.c_str());
+            }
+
+            void BinaryTrainingSetWriter::close() throw (SDException&){
+                if (file.is_open() == false){
+                    return;
+                }
+                header.rows = labels.size();
+                if (featureType == TRAINING_SET_UINT8){
+                    writeQuantized();
+                }
+                if (labels.empty() == false){
+                    file.write((const char*)&labels[0], labels.size());
+                }
+                if (featureType == TRAINING_SET_FLOAT32){
+                    file.seekp(0);
+                    file.write((const char*)&header, sizeof(header));
+                }
+                bool failed = file.fail();
+                file.close();
+                labels.clear();
+                if (failed){
+                    SDException exc(SHADOW_WRITE_UNABLE, "BinaryTrainingSetWriter::close");
+                    throw exc;
+                }
+            }
+
+            BinaryTrainingSet::BinaryTrainingSet(){
+                fd = -1;
+                fileSize = 0;
+                data = 0;
+                header = 0;
+                offsets = 0;
+                steps = 0;
+                features = 0;
+                labels = 0;
+            }
+
+            BinaryTrainingSet::~BinaryTrainingSet(){
+                close();
+            }
+
+            bool BinaryTrainingSet::isBinary(const string& filePath){
+                fstream file;
+                file.open(filePath.c_str(), fstream::in | fstream::binary);
+                FileRaii fRaii(&file);
+                if (file.is_open() == false){
+                    return false;
+                }
+                char magic[sizeof(BINARY_TRAINING_SET_MAGIC)];
+                file.read(magic, sizeof(magic));
+                if (file.gcount() != (streamsize)sizeof(magic)){
+                    return false;
+                }
+                return memcmp(magic, BINARY_TRAINING_SET_MAGIC, sizeof(magic)) == 0;
+            }
+
+            void BinaryTrainingSet::open(const string& filePath) throw (SDException&){
+                close();
+                fd = ::open(filePath.c_str(), O_RDONLY);
+                if (fd < 0){
+                    SDException exc(SHADOW_READ_UNABLE, "BinaryTrainingSet::open");
+                    throw exc;
+                }
+                struct stat fileStat;
+                if (fstat(fd, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(BinaryTrainingSetHeader)){
+                    close();
+                    SDException exc(SHADOW_READ_UNABLE, "BinaryTrainingSet::open");
+                    throw exc;
+                }
+                fileSize = fileStat.st_size;
+                void* mapped = mmap(0, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped == MAP_FAILED){
+                    fileSize = 0;
+                    close();
+                    SDException exc(SHADOW_READ_UNABLE, "BinaryTrainingSet::open");
+                    throw exc;
+                }
+                madvise(mapped, fileSize, MADV_SEQUENTIAL);
+                data = (const unsigned char*)mapped;
+                header = (const BinaryTrainingSetHeader*)data;
+
+                size_t offset = sizeof(BinaryTrainingSetHeader);
+                bool valid = memcmp(header->magic, BINARY_TRAINING_SET_MAGIC, sizeof(BINARY_TRAINING_SET_MAGIC)) == 0 &&
+                             header->version == BINARY_TRAINING_SET_VERSION &&
+                             (header->featureType == TRAINING_SET_FLOAT32 || header->featureType == TRAINING_SET_UINT8);
+                if (valid && header->featureType == TRAINING_SET_UINT8){
+                    offsets = (const float*)(data + offset);
+                    steps = offsets + header->dimension;
+                    offset += 2 * header->dimension * sizeof(float);
+                }
+                features = data + offset;
+                offset += header->rows * header->dimension * featureSize(header->featureType);
+                labels = data + offset;
+                offset += header->rows;
+                if (valid == false || offset != fileSize){
+                    close();
+                    SDException exc(SHADOW_READ_UNABLE, "BinaryTrainingSet::open");
+                    throw exc;
+                }
+            }
+
+            void BinaryTrainingSet::close(){
+                if (data != 0){
+                    munmap((void*)data, fileSize);
+                }
+                if (fd >= 0){
+                    ::close(fd);
+                }
+                fd = -1;
+                fileSize = 0;
+                data = 0;
+                header = 0;
+                offsets = 0;
+                steps = 0;
+                features = 0;
+                labels = 0;
+            }
+
+            uint64_t BinaryTrainingSet::getRows() const{
+                return (header != 0) ? header->rows : 0;
+            }
+
+            uint32_t BinaryTrainingSet::getDimension() const{
+                return (header != 0) ? header->dimension : 0;
+            }
+
+            TRAINING_SET_FEATURE_TYPE BinaryTrainingSet::getFeatureType() const{
+                return (header != 0) ? (TRAINING_SET_FEATURE_TYPE)header->featureType : TRAINING_SET_FLOAT32;
+            }
+
+            unsigned char BinaryTrainingSet::getLabel(uint64_t row) const{
+                return labels[row];
+            }
+
+            float BinaryTrainingSet::getFeature(uint64_t row, uint32_t index) const{
+                uint64_t pos = row * header->dimension + index;
+                if (header->featureType == TRAINING_SET_UINT8){
+                    return offsets[index] + (float)features[pos] * steps[index];
+                }
+                return ((const float*)features)[pos];
+            }
+
+            void BinaryTrainingSet::getFeatures(uint64_t row, float* dst) const{
+                uint32_t dimension = header->dimension;
+                if (header->featureType == TRAINING_SET_UINT8){
+                    const unsigned char* src = features + row * dimension;
+                    for (uint32_t j = 0; j < dimension; j++){
+                        dst[j] = offsets[j] + (float)src[j] * steps[j];
+                    }
+                }
+                else{
+                    memcpy(dst, features + row * dimension * sizeof(float), dimension * sizeof(float));
+                }
+            }
+
+            void BinaryTrainingSet::exportText(const string& filePath) const throw (SDException&){
+                fstream file;
+                file.open(filePath.c_str(), fstream::out | fstream::trunc);
+                FileRaii fRaii(&file);
+                if (file.is_open() == false || header == 0){
+                    SDException exc(SHADOW_WRITE_UNABLE, "BinaryTrainingSet::exportText");
+                    throw exc;
+                }
+                uint32_t dimension = header->dimension;
+                vector<float> row(dimension);
+                for (uint64_t i = 0; i < header->rows; i++){
+                    if (i > 0){
+                        file << "\n";
+                    }
+                    if (dimension > 0)
+                        getFeatures(i, &row[0]);
+                    //same formatting as text training set
+                    file << (float)labels[i];
+                    for (uint32_t j = 0; j < dimension; j++){
+                        file << " " << (j + 1) << ":" << row[j];
+                    }
+                }
+            }
+
+        }
+    }
+}
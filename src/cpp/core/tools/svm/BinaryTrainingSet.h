@@ -0,0 +1,130 @@
+#ifndef __BINARY_TRAINING_SET_H__
+#define __BINARY_TRAINING_SET_H__
+
+#include <fstream>
+#include <vector>
+#include <stdint.h>
+#include "typedefs.h"
+
+#define BINARY_TRAINING_SET_MAGIC "SDTRSET"
+#define BINARY_TRAINING_SET_VERSION 1
+
+namespace core{
+    namespace tools{
+        namespace svm{
+
+            enum TRAINING_SET_FEATURE_TYPE{
+                TRAINING_SET_FLOAT32 = 0,
+                TRAINING_SET_UINT8 = 1
+            };
+
+            /**
+             * File layout: header, for uint8 features offset and step of each feature (floats),
+             * feature block rows * dimension in row major order, label column rows bytes
+             */
+            struct BinaryTrainingSetHeader{
+                char magic[8];
+                uint32_t version;
+                uint32_t featureType;
+                uint64_t rows;
+                //features in row, label excluded
+                uint32_t dimension;
+                uint32_t reserved;
+            };
+
+            /**
+             * writes training rows in binary format. Rows are same as in text training set,
+             * label first and features after it. Float features are written as they come,
+             * uint8 features are kept in temporary float file until range of each feature is known
+             */
+            class BinaryTrainingSetWriter{
+            private:
+                std::string filePath;
+                std::string featurePath;
+                std::fstream file;
+                TRAINING_SET_FEATURE_TYPE featureType;
+                BinaryTrainingSetHeader header;
+                std::vector<unsigned char> labels;
+                std::vector<float> minValues;
+                std::vector<float> maxValues;
+
+                void writeQuantized() throw (SDException&);
+            protected:
+            public:
+                BinaryTrainingSetWriter();
+                virtual ~BinaryTrainingSetWriter();
+                /**
+                 * creates output file, dimension is taken from first added rows
+                 * @param filePath
+                 * @param featureType
+                 */
+                void open(const std::string& filePath, TRAINING_SET_FEATURE_TYPE featureType) throw (SDException&);
+                /**
+                 * @param rows
+                 * count rows of rowDimension floats, first value in row is label
+                 * @param count
+                 * @param rowDimension
+                 * label and features
+                 */
+                void addRows(const float* rows, size_t count, int rowDimension) throw (SDException&);
+                /**
+                 * writes label column and final header
+                 */
+                void close() throw (SDException&);
+            };
+
+            /**
+             * memory mapped binary training set
+             */
+            class BinaryTrainingSet{
+            private:
+                int fd;
+                size_t fileSize;
+                const unsigned char* data;
+                const BinaryTrainingSetHeader* header;
+                const float* offsets;
+                const float* steps;
+                const unsigned char* features;
+                const unsigned char* labels;
+            protected:
+            public:
+                BinaryTrainingSet();
+                virtual ~BinaryTrainingSet();
+                /**
+                 * checks magic at beginning of file
+                 * @param filePath
+                 * @return
+                 */
+                static bool isBinary(const std::string& filePath);
+                void open(const std::string& filePath) throw (SDException&);
+                void close();
+                uint64_t getRows() const;
+                uint32_t getDimension() const;
+                TRAINING_SET_FEATURE_TYPE getFeatureType() const;
+                unsigned char getLabel(uint64_t row) const;
+                /**
+                 * @param row
+                 * @param index
+                 * feature index, label excluded
+                 * @return
+                 * dequantized feature value
+                 */
+                float getFeature(uint64_t row, uint32_t index) const;
+                /**
+                 * @param row
+                 * @param dst
+                 * dimension dequantized features of row
+                 */
+                void getFeatures(uint64_t row, float* dst) const;
+                /**
+                 * writes set in libsvm text format, same as text training set
+                 * @param filePath
+                 */
+                void exportText(const std::string& filePath) const throw (SDException&);
+            };
+
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,163 @@
+#include "TrainingSampler.h"
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include "core/util/Config.h"
+#include "core/tools/image/ImageView.h"
+
+namespace core{
+    namespace tools{
+        namespace svm{
+
+            using namespace std;
+            using namespace cv;
+            using namespace core::util;
+            using namespace core::tools::image;
+
+            bool largerRemainder(const Pair<double>& a, const Pair<double>& b){
+                return a.getFirst() > b.getFirst();
+            }
+
+            TrainingSampler::TrainingSampler(){
+                imageCount = 1;
+                init();
+            }
+
+            TrainingSampler::~TrainingSampler(){
+            }
+
+            void TrainingSampler::init() throw (SDException&){
+                Config* conf = Config::getInstancePtr();
+                string useSamplingStr = conf->getPropertyValue("general.Training.Sampling.useSampling");
+                useSampling = useSamplingStr.compare("true") == 0;
+                string sampleRateStr = conf->getPropertyValue("general.Training.Sampling.sampleRate");
+                sampleRate = clamp<float>((float)atof(sampleRateStr.c_str()), 0.f, 1.f);
+                string maxPerClassStr = conf->getPropertyValue("general.Training.Sampling.maxPerClass");
+                maxPerClass = (uint)atoi(maxPerClassStr.c_str());
+                string maxTotalStr = conf->getPropertyValue("general.Training.Sampling.maxTotal");
+                maxTotal = (uint)atoi(maxTotalStr.c_str());
+                string lightnessBinsStr = conf->getPropertyValue("general.Training.Sampling.lightnessBins");
+                lightnessBins = clamp<int>(atoi(lightnessBinsStr.c_str()), 1, 256);
+                string seedStr = conf->getPropertyValue("general.Training.Sampling.seed");
+                seed = (uint)atoi(seedStr.c_str());
+            }
+
+            bool TrainingSampler::isEnabled() const{
+                return useSampling;
+            }
+
+            void TrainingSampler::setImageCount(size_t count){
+                imageCount = max(count, (size_t)1);
+            }
+
+            uint TrainingSampler::classQuota(size_t classSize, int classRank, int nonEmptyClasses, uint imageIndex) const{
+                double quota = floor((double)classSize * sampleRate + 0.5);
+                if (maxPerClass > 0 && quota > maxPerClass)
+                    quota = maxPerClass;
+                if (maxTotal > 0){
+                    //budgets of all images sum to maxTotal, even when it is smaller than image count
+                    size_t imageBudget = maxTotal / imageCount;
+                    if (imageIndex % imageCount < maxTotal % imageCount)
+                        imageBudget++;
+                    size_t classBudget = imageBudget / nonEmptyClasses;
+                    if ((size_t)((classRank + imageIndex) % nonEmptyClasses) < imageBudget % nonEmptyClasses)
+                        classBudget++;
+                    if (quota > classBudget)
+                        quota = (double)classBudget;
+                }
+                return (uint)quota;
+            }
+
+            void TrainingSampler::sample(const Mat& mask, ImageContext& context, uint imageIndex,
+                                        vector<uint>& pixelIndices) const throw (SDException&){
+                pixelIndices.clear();
+                if (mask.rows != context.getHeight() || mask.cols != context.getWidth()){
+                    SDException exc(SHADOW_DIFFERENT_IMAGES_SIZES, "TrainingSampler::sample");
+                    throw exc;
+                }
+                ConstMaskView maskView(mask);
+                int width = maskView.getCols();
+                int height = maskView.getRows();
+                //stratum index is class * lightnessBins + bin, pixels with mask other than
+                //0 and 255 have no label in training set and are left out
+                vector< vector<uint> > strata(TRAINING_SAMPLER_CLASS_COUNT * lightnessBins);
+                if (lightnessBins > 1){
+                    ConstColorView hlsView(context.getHLS());
+                    for (int i = 0; i < height; i++){
+                        const uchar* maskRow = maskView.row(i);
+                        const uchar* hlsRow = hlsView.row(i);
+                        for (int j = 0; j < width; j++){
+                            if (maskRow[j] != 0 && maskRow[j] != 255)
+                                continue;
+                            int bin = hlsRow[j * 3 + 1] * lightnessBins / 256;
+                            int cls = (maskRow[j] != 0) ? 1 : 0;
+                            strata[cls * lightnessBins + bin].push_back((uint)(i * width + j));
+                        }
+                    }
+                }
+                else{
+                    for (int i = 0; i < height; i++){
+                        const uchar* maskRow = maskView.row(i);
+                        for (int j = 0; j < width; j++){
+                            if (maskRow[j] != 0 && maskRow[j] != 255)
+                                continue;
+                            strata[(maskRow[j] != 0) ? 1 : 0].push_back((uint)(i * width + j));
+                        }
+                    }
+                }
+
+                size_t classSizes[TRAINING_SAMPLER_CLASS_COUNT] = {0};
+                int nonEmptyClasses = 0;
+                for (int cls = 0; cls < TRAINING_SAMPLER_CLASS_COUNT; cls++){
+                    for (int bin = 0; bin < lightnessBins; bin++){
+                        classSizes[cls] += strata[cls * lightnessBins + bin].size();
+                    }
+                    if (classSizes[cls] > 0)
+                        nonEmptyClasses++;
+                }
+
+                //independent sequence for each image
+                seed_seq seq = {seed, imageIndex};
+                mt19937 rng(seq);
+                vector<size_t> counts(lightnessBins);
+                vector< Pair<double> > remainders;
+                int classRank = 0;
+                for (int cls = 0; cls < TRAINING_SAMPLER_CLASS_COUNT; cls++){
+                    if (classSizes[cls] == 0)
+                        continue;
+                    uint quota = classQuota(classSizes[cls], classRank++, nonEmptyClasses, imageIndex);
+                    //proportional allocation over bins, leftover goes to largest remainders
+                    size_t assigned = 0;
+                    remainders.clear();
+                    for (int bin = 0; bin < lightnessBins; bin++){
+                        double exact = (double)quota * strata[cls * lightnessBins + bin].size() / classSizes[cls];
+                        counts[bin] = (size_t)exact;
+                        assigned += counts[bin];
+                        remainders.push_back(Pair<double>(exact - counts[bin], bin));
+                    }
+                    stable_sort(remainders.begin(), remainders.end(), largerRemainder);
+                    for (size_t k = 0; assigned < quota && k < remainders.size(); k++){
+                        int bin = (int)remainders[k].getSecond();
+                        if (counts[bin] < strata[cls * lightnessBins + bin].size()){
+                            counts[bin]++;
+                            assigned++;
+                        }
+                    }
+                    //partial Fisher-Yates shuffle, first counts[bin] elements are sample
+                    for (int bin = 0; bin < lightnessBins; bin++){
+                        vector<uint>& stratum = strata[cls * lightnessBins + bin];
+                        size_t size = stratum.size();
+                        for (size_t k = 0; k < counts[bin]; k++){
+                            uniform_int_distribution<size_t> distribution(k, size - 1);
+                            size_t pick = distribution(rng);
+                            swap(stratum[k], stratum[pick]);
+                        }
+                        pixelIndices.insert(pixelIndices.end(), stratum.begin(), stratum.begin() + counts[bin]);
+                    }
+                }
+                sort(pixelIndices.begin(), pixelIndices.end());
+            }
+
+        }
+    }
+}
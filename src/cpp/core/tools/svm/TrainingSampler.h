@@ -0,0 +1,71 @@
+#ifndef __TRAINING_SAMPLER_H__
+#define __TRAINING_SAMPLER_H__
+
+#include <vector>
+#include "typedefs.h"
+#include "opencv2/core/core.hpp"
+#include "core/tools/image/ImageContext.h"
+
+#define TRAINING_SAMPLER_CLASS_COUNT 2
+
+namespace core{
+    namespace tools{
+        namespace svm{
+
+            /**
+             * chooses pixels of training image before feature extraction. Pixels are split in strata
+             * by class (mask 0 or 255, other mask values are not sampled) and optionally by HLS
+             * lightness bin, each class gets sampleRate of its pixels limited by per class and
+             * global budgets, distributed over lightness bins proportionally. Global budget is split
+             * evenly between images and classes, remainders go one by one to first images and
+             * to classes rotated by image index. Selection depends only on seed and image index,
+             * so it does not change with thread count.
+             * Configured in general.Training.Sampling
+             */
+            class TrainingSampler{
+            private:
+                bool useSampling;
+                float sampleRate;
+                uint maxPerClass;
+                uint maxTotal;
+                int lightnessBins;
+                uint seed;
+                size_t imageCount;
+
+                void init() throw (SDException&);
+                uint classQuota(size_t classSize, int classRank, int nonEmptyClasses, uint imageIndex) const;
+            protected:
+            public:
+                TrainingSampler();
+                virtual ~TrainingSampler();
+
+                /**
+                 * @return
+                 * true if sampling is turned on in configuration
+                 */
+                bool isEnabled() const;
+                /**
+                 * global budget is divided evenly between images
+                 * @param count
+                 * number of images in training set
+                 */
+                void setImageCount(size_t count);
+                /**
+                 * @param mask
+                 * 8bit single channel training mask
+                 * @param context
+                 * context of original image, HLS is used for lightness bins
+                 * @param imageIndex
+                 * index of image in training set, selects random sequence
+                 * @param pixelIndices
+                 * output, selected pixels (row * width + column) in ascending order
+                 */
+                void sample(const cv::Mat& mask, core::tools::image::ImageContext& context, uint imageIndex,
+                            std::vector<uint>& pixelIndices) const throw (SDException&);
+            };
+
+        }
+    }
+}
+
+#endif
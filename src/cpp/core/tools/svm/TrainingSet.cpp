@@ -1,11 +1,20 @@
 #include "TrainingSet.h"
 #include <fstream>
 #include <iostream>
+#include <cstdio>
+#include <memory>
+#include <algorithm>
+#include <pthread.h>
 #include "core/util/raii/RAIIS.h"
 #include "typedefs.h"
 #include "core/opencv/OpenCV2Tools.h"
 #include "core/util/rtti/ObjectFactory.h"
 #include "core/tools/image/IImageParameters.h"
+#include "core/util/Config.h"
+#include "core/tools/image/ImageView.h"
+#if defined _OPENMP_MY
+#include <omp.h>
+#endif
 
 namespace core{
     namespace tools{
@@ -38,71 +47,214 @@ namespace core{
                 }
             }
 
-            string getStr(const float* arr, int dimension) {
-                stringstream stream;
+            //appends label and features of one row, %g gives same text as default stream output
+            void appendRow(string& text, const float* arr, int dimension) {
+                char buffer[64];
                 for (int i = 0; i < dimension; i++) {
                     if (i == 0) {
-                        stream << arr[i];
+                        snprintf(buffer, sizeof(buffer), "%g", arr[i]);
                     } else {
-                        stream << " " << i << ":" << arr[i];
+                        snprintf(buffer, sizeof(buffer), " %d:%g", i, arr[i]);
                     }
+                    text += buffer;
+                }
+            }
+
+            size_t TrainingSet::formatImage(const Matrix<float>* processed, int dimension, int pixelNum,
+                                            bool outputAll, bool binary, ImageChunk& chunk){
+                bool first = true;
+                chunk.dimension = dimension;
+                //to have same number of 1s and 0s, balancing restarts for each image
+                bool write0 = true;
+                size_t invalid = 0;
+                for (int j = 0; j < pixelNum; j++) {
+                    float label = (*processed)[j][0];
+                    if (label != 0.f && label != 1.f){
+                        invalid++;
+                        continue;
+                    }
+                    bool succ = false;
+                    if (outputAll == false){
+                        if (write0){
+                            if ((*processed)[j][0] == 0.f)
+                                succ = true;
+                        }
+                        else{
+                            if ((*processed)[j][0] != 0.f)
+                                succ = true;
+                        }
+                    }
+                    else
+                        succ = true;
+                    if (succ){
+                        if (binary){
+                            chunk.rows.insert(chunk.rows.end(), (*processed)[j], (*processed)[j] + dimension);
+                            write0 = !write0;
+                            continue;
+                        }
+                        if (first == false) {
+                            chunk.text += '\n';
+                        }
+                        appendRow(chunk.text, (*processed)[j], dimension);
+                        first = false;
+                        write0 = !write0;
+                    }
+                }
+                return invalid;
+            }
+
+            void TrainingSet::writeReadyChunks(fstream& file, BinaryTrainingSetWriter* writer, vector<ImageChunk>& chunks,
+                                                size_t& nextToWrite, bool& first) throw (SDException&){
+                while (nextToWrite < chunks.size() && chunks[nextToWrite].ready) {
+                    ImageChunk& chunk = chunks[nextToWrite];
+                    if (writer != 0){
+                        if (chunk.rows.empty() == false){
+                            writer->addRows(&chunk.rows[0], chunk.rows.size() / chunk.dimension, chunk.dimension);
+                        }
+                    }
+                    else if (chunk.text.empty() == false){
+                        if (first == false) {
+                            file << "\n";
+                        }
+                        file << chunk.text;
+                        first = false;
+                    }
+                    string().swap(chunk.text);
+                    vector<float>().swap(chunk.rows);
+                    nextToWrite++;
                 }
-                string retStr = stream.str();
-                return retStr;
             }
 
             void TrainingSet::processImages(string output, bool outputAll) throw (SDException&) {
+                string format = Config::getInstancePtr()->getPropertyValue("general.Training.setFormat");
+                bool binary = format.compare("text") != 0;
                 fstream file;
-                file.open(output.c_str(), fstream::out | fstream::trunc);
+                BinaryTrainingSetWriter writer;
+                if (binary){
+                    writer.open(output, (format.compare("binary8") == 0) ? TRAINING_SET_UINT8 : TRAINING_SET_FLOAT32);
+                }
+                else{
+                    file.open(output.c_str(), fstream::out | fstream::trunc);
+                }
                 FileRaii fRaii(&file);
-                if (file.is_open()) {
+                if (binary || file.is_open()) {
                     size_t size = images.size();
+                    TrainingSampler sampler;
+                    sampler.setImageCount(size);
+                    bool deduplicate = Config::getInstancePtr()->getPropertyValue("general.Training.deduplicate").compare("true") == 0;
+                    //sampled and deduplicated rows are written without 0/1 alternation
+                    bool writeAll = outputAll || sampler.isEnabled();
+                    ColorCounts colorCounts;
+                    //images are processed out of order, formatted rows wait here
+                    //until all previous images are written
+                    vector<ImageChunk> chunks(size);
+                    size_t nextToWrite = 0;
                     bool first = true;
-                    for (uint i = 0; i < size; i++) {
-                        Pair<string> pair = images[i];
-                        cout << "processing: " << pair.getFirst() << endl;
-                        int dimension = 0;
-                        int pixelNum = 0;
-                        const Matrix<float>* processed = processImage(pair.getFirst(), pair.getSecond(), dimension, pixelNum);
-                        cout << "Size: " << pixelNum;
-                        if (processed != 0) {
-                            //to have same number of 1s and 0s
-                            bool write0 = true;
-                            for (int j = 0; j < pixelNum; j++) {                                
-                                bool succ = false;
-                                if (outputAll == false){                                
-                                    if (write0){
-                                        if ((*processed)[j][0] == 0.f)
-                                            succ = true;
-                                    }
-                                    else{
-                                        if ((*processed)[j][0] != 0.f)
-                                            succ = true;
-                                    }
+                    //first failed image, later images are skipped
+                    size_t errorIndex = size;
+                    UNIQUE_PTR(SDException) error;
+                    pthread_mutex_t writerMutex = PTHREAD_MUTEX_INITIALIZER;
+                    //signaled when chunks are written or processing fails
+                    pthread_cond_t writtenCond = PTHREAD_COND_INITIALIZER;
+                    int threadCount = 1;
+#if defined _OPENMP_MY && !defined _OPENCL
+                    threadCount = omp_get_max_threads();
+#endif
+                    //image is started only when it is less than window images ahead of next one
+                    //to write, so at most window formatted chunks wait in memory. Images are
+                    //handed out in order, thread with lowest unwritten image never waits
+                    size_t window = (size_t)threadCount;
+                    //singletons are created here, not by first thread which needs them
+                    ObjectFactory* factory = ObjectFactory::getInstancePtr();
+                    vector< UNIQUE_PTR(IImageParameteres) > threadParameters(threadCount);
+                    for (int t = 0; t < threadCount; t++){
+                        threadParameters[t].reset(factory->createImageParameters());
+                    }
+                    int i;
+                    //OpenCL image parameters share one device context, so there images stay sequential
+#if defined _OPENMP_MY && !defined _OPENCL
+#pragma omp parallel for private(i) schedule(dynamic, 1) num_threads(threadCount)
+#endif
+                    for (i = 0; i < (int)size; i++) {
+                        int thread = 0;
+#if defined _OPENMP_MY && !defined _OPENCL
+                        thread = omp_get_thread_num();
+#endif
+                        {
+                            MutexRaii autoLock(&writerMutex);
+                            while ((size_t)i <= errorIndex && (size_t)i >= nextToWrite + window)
+                                pthread_cond_wait(&writtenCond, &writerMutex);
+                            if ((size_t)i > errorIndex)
+                                continue;
+                            cout << "processing: " << images[i].getFirst() << endl;
+                        }
+                        ImageChunk chunk;
+                        ColorCounts imageCounts;
+                        size_t invalid = 0;
+                        try{
+                            if (deduplicate){
+                                countColors(images[i].getFirst(), images[i].getSecond(), i, sampler, imageCounts);
+                            }
+                            else{
+                                int dimension = 0;
+                                int pixelNum = 0;
+                                const Matrix<float>* processed = processImage(images[i].getFirst(), images[i].getSecond(), 
+                                                                                i, sampler, *threadParameters[thread],
+                                                                                dimension, pixelNum);
+                                if (processed == 0){
+                                    SDException exc(SHADOW_READ_UNABLE, "TrainingSet::processImages");
+                                    throw exc;
                                 }
-                                else
-                                    succ = true;
-                                if (succ){
-                                    string str = getStr((*processed)[j], dimension);
-                                    string tmp = str.substr(0, 2);
-                                    if (tmp.compare("1 ") != 0 && tmp.compare("0 ") != 0){
-                                        cout << "Error create train set, label value: " << tmp << endl;
-                                    }
-                                    
-                                    if (first == false) {
-                                        file << endl;
-                                    }
-                                    file << str;
-                                    first = false;
-                                    write0 = !write0;
-                                }                                
+                                invalid = formatImage(processed, dimension, pixelNum, writeAll, binary, chunk);
+                                Delete(processed);
                             }
-                            Delete(processed);
                         }
-                        else{
-                            SDException exc(SHADOW_READ_UNABLE, "TrainingSet::processImages");
-                            throw exc;
+                        catch (SDException& exception){
+                            MutexRaii autoLock(&writerMutex);
+                            if ((size_t)i < errorIndex){
+                                errorIndex = i;
+                                error.reset(New SDException(exception));
+                            }
+                            pthread_cond_broadcast(&writtenCond);
+                            continue;
                         }
+                        MutexRaii autoLock(&writerMutex);
+                        if (invalid > 0){
+                            cout << "Error create train set, skipped rows with label other than 0 and 1: " << invalid << endl;
+                        }
+                        for (ColorCounts::const_iterator it = imageCounts.begin(); it != imageCounts.end(); it++){
+                            colorCounts[it->first] += it->second;
+                        }
+                        chunks[i].text.swap(chunk.text);
+                        chunks[i].rows.swap(chunk.rows);
+                        chunks[i].dimension = chunk.dimension;
+                        chunks[i].ready = true;
+                        try{
+                            writeReadyChunks(file, binary ? &writer : 0, chunks, nextToWrite, first);
+                        }
+                        catch (SDException& exception){
+                            if ((size_t)i < errorIndex){
+                                errorIndex = i;
+                                error.reset(New SDException(exception));
+                            }
+                        }
+                        pthread_cond_broadcast(&writtenCond);
+                    }
+                    pthread_cond_destroy(&writtenCond);
+                    pthread_mutex_destroy(&writerMutex);
+                    if (error.get() != 0){
+                        SDException exc(*error);
+                        throw exc;
+                    }
+                    if (deduplicate){
+                        writeDeduplicated(colorCounts, output, file, binary ? &writer : 0, first);
+                    }
+                    else{
+                        //training reads weights whenever file exists, old one would not match rows
+                        remove((output + ".weights").c_str());
+                    }
+                    if (binary){
+                        writer.close();
                     }
                 } else {
                     SDException exc(SHADOW_WRITE_UNABLE, "TrainingSet::processImages");
@@ -110,19 +262,154 @@ namespace core{
                 }
             }
 
-            Matrix<float>* TrainingSet::processImage(std::string orImage, std::string maskImg, int& rowDimesion, int& pixelNum) {
+            Matrix<float>* TrainingSet::processImage(std::string orImage, std::string maskImg, uint imageIndex,
+                                                    const TrainingSampler& sampler, IImageParameteres& ip,
+                                                    int& rowDimesion, int& pixelNum) {
                 Mat originalImage = cv::imread(orImage, CV_LOAD_IMAGE_COLOR);
                 Mat maskImage = cv::imread(maskImg, CV_LOAD_IMAGE_GRAYSCALE);
 
                 if (originalImage.data == 0 || maskImage.data == 0) {
                     return 0;
                 }                
-                UNIQUE_PTR(IImageParameteres) ipPtr(ObjectFactory::getInstancePtr()->createImageParameters());
-                Matrix<float>* retVec = ipPtr->getImageParameters( originalImage, maskImage, 
-                                                                rowDimesion, pixelNum);                
+                ImageContext context(originalImage);
+                if (sampler.isEnabled() == false){
+                    Matrix<float>* retVec = ip.getImageParameters( context, maskImage, 
+                                                                    rowDimesion, pixelNum);
+                    return retVec;
+                }
+
+                //features only for sampled pixels, label is added same way as for whole image
+                vector<uint> pixelIndices;
+                sampler.sample(maskImage, context, imageIndex, pixelIndices);
+                int noLabelDimension = 0;
+                int count = 0;
+                UNIQUE_PTR(const Matrix<float>) noLabelPtr(ip.getImageParameters(context, pixelIndices, 
+                                                                                    noLabelDimension, count));
+                if (noLabelPtr.get() == 0){
+                    return 0;
+                }
+                rowDimesion = noLabelDimension + 1;
+                pixelNum = count;
+                Matrix<float>* retVec = New Matrix<float>(rowDimesion, count);
+                const float* noLabelData = noLabelPtr->getVec();
+                float* retData = retVec->getVec();
+                for (int i = 0; i < count; i++){
+                    uint index = pixelIndices[i];
+                    const uchar* maskRow = maskImage.ptr<uchar>(index / maskImage.cols);
+                    float* row = retData + i * rowDimesion;
+                    row[0] = (float)maskRow[index % maskImage.cols] / 255.f;
+                    memcpy(row + 1, noLabelData + i * noLabelDimension, noLabelDimension * sizeof(float));
+                }
                 return retVec;
             }
 
+            void TrainingSet::countColors(std::string orImage, std::string maskImg, uint imageIndex,
+                                            const TrainingSampler& sampler, ColorCounts& counts) throw (SDException&){
+                Mat originalImage = cv::imread(orImage, CV_LOAD_IMAGE_COLOR);
+                Mat maskImage = cv::imread(maskImg, CV_LOAD_IMAGE_GRAYSCALE);
+                if (originalImage.data == 0 || maskImage.data == 0) {
+                    SDException exc(SHADOW_READ_UNABLE, "TrainingSet::countColors");
+                    throw exc;
+                }
+                if (originalImage.size() != maskImage.size()){
+                    SDException exc(SHADOW_DIFFERENT_IMAGES_SIZES, "TrainingSet::countColors");
+                    throw exc;
+                }
+                ConstColorView colorView(originalImage);
+                ConstMaskView maskView(maskImage);
+                int width = colorView.getCols();
+                if (sampler.isEnabled()){
+                    ImageContext context(originalImage);
+                    vector<uint> pixelIndices;
+                    sampler.sample(maskImage, context, imageIndex, pixelIndices);
+                    for (size_t k = 0; k < pixelIndices.size(); k++){
+                        int row = pixelIndices[k] / width;
+                        int col = pixelIndices[k] % width;
+                        counts[colorKey(colorView.pixel(row, col), maskView.row(row)[col])]++;
+                    }
+                    return;
+                }
+                for (int i = 0; i < colorView.getRows(); i++){
+                    const uchar* pixel = colorView.row(i);
+                    const uchar* maskRow = maskView.row(i);
+                    for (int j = 0; j < width; j++){
+                        counts[colorKey(pixel, maskRow[j])]++;
+                        pixel += 3;
+                    }
+                }
+            }
+
+            void TrainingSet::writeDeduplicated(const ColorCounts& counts, const string& output, fstream& file,
+                                                BinaryTrainingSetWriter* writer, bool& first) throw (SDException&){
+                //sorted keys give same output for any processing order
+                vector< pair<uint32_t, uint32_t> > entries;
+                entries.reserve(counts.size());
+                size_t invalid = 0;
+                for (ColorCounts::const_iterator it = counts.begin(); it != counts.end(); it++){
+                    //same as formatImage, mask values other than 0 and 255 are skipped
+                    uint32_t mask = it->first & 0xff;
+                    if (mask != 0 && mask != 255){
+                        invalid += it->second;
+                        continue;
+                    }
+                    entries.push_back(*it);
+                }
+                if (invalid > 0){
+                    cout << "Error create train set, skipped rows with label other than 0 and 1: " << invalid << endl;
+                }
+                sort(entries.begin(), entries.end());
+                string weightsPath = output + ".weights";
+                fstream weights;
+                weights.open(weightsPath.c_str(), fstream::out | fstream::trunc);
+                FileRaii wRaii(&weights);
+                if (weights.is_open() == false){
+                    SDException exc(SHADOW_WRITE_UNABLE, "TrainingSet::writeDeduplicated");
+                    throw exc;
+                }
+                UNIQUE_PTR(IImageParameteres) ipPtr(ObjectFactory::getInstancePtr()->createImageParameters());
+                size_t total = entries.size();
+                //unique colors are processed as one row images
+                for (size_t start = 0; start < total; start += DEDUPLICATE_BLOCK_SIZE){
+                    int count = (int)min(total - start, (size_t)DEDUPLICATE_BLOCK_SIZE);
+                    Mat colors(1, count, CV_8UC3);
+                    uchar* pixel = colors.ptr<uchar>(0);
+                    for (int k = 0; k < count; k++){
+                        uint32_t key = entries[start + k].first;
+                        pixel[0] = (uchar)(key >> 24);
+                        pixel[1] = (uchar)(key >> 16);
+                        pixel[2] = (uchar)(key >> 8);
+                        pixel += 3;
+                    }
+                    ImageContext context(colors);
+                    int noLabelDimension = 0;
+                    int pixelNum = 0;
+                    UNIQUE_PTR(const Matrix<float>) noLabelPtr(ipPtr->getImageParameters(context, noLabelDimension, pixelNum));
+                    if (noLabelPtr.get() == 0 || pixelNum != count){
+                        SDException exc(SHADOW_CANT_GET_PARAMETERS, "TrainingSet::writeDeduplicated");
+                        throw exc;
+                    }
+                    int dimension = noLabelDimension + 1;
+                    UNIQUE_PTR(Matrix<float>) labeled(New Matrix<float>(dimension, count));
+                    const float* noLabelData = noLabelPtr->getVec();
+                    float* labeledData = labeled->getVec();
+                    for (int k = 0; k < count; k++){
+                        float* row = labeledData + k * dimension;
+                        row[0] = (float)(entries[start + k].first & 0xff) / 255.f;
+                        memcpy(row + 1, noLabelData + k * noLabelDimension, noLabelDimension * sizeof(float));
+                        if (start + k > 0){
+                            weights << "\n";
+                        }
+                        weights << entries[start + k].second;
+                    }
+                    vector<ImageChunk> chunks(1);
+                    formatImage(labeled.get(), dimension, count, true, writer != 0, chunks[0]);
+                    chunks[0].ready = true;
+                    size_t nextToWrite = 0;
+                    writeReadyChunks(file, writer, chunks, nextToWrite, first);
+                }
+                cout << "Unique samples: " << total << endl;
+            }
+
             TrainingSet::TrainingSet() {
 
             }
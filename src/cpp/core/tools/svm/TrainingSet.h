@@ -2,20 +2,97 @@
 #define __TRAINING_SET_H__
 
 #include <fstream>
+#include <unordered_map>
+#include <stdint.h>
 #include "typedefs.h"
 #include "core/util/Matrix.h"
+#include "BinaryTrainingSet.h"
+#include "TrainingSampler.h"
+
+//unique colors processed at once when writing deduplicated set
+#define DEDUPLICATE_BLOCK_SIZE 65536
 
 namespace core{
     namespace tools{
+        namespace image{
+            class IImageParameteres;
+        }
+        
         namespace svm{
+            /**
+             * creates training set from images listed in csv file. Output format is chosen with
+             * general.Training.setFormat, libsvm text or binary (float32 or uint8 features)
+             */
             class TrainingSet{
             private:
+                //(B, G, R, mask value) packed in one key, see colorKey
+                typedef std::unordered_map<uint32_t, uint32_t> ColorCounts;
+
+                /**
+                 * formatted rows of one image waiting to be written
+                 */
+                struct ImageChunk{
+                    std::string text;
+                    std::vector<float> rows;
+                    int dimension;
+                    bool ready;
+
+                    ImageChunk(){
+                        dimension = 0;
+                        ready = false;
+                    }
+                };
+
                 std::string filePath;
                 std::vector< Pair<std::string> > images;
 
                 void readFile() throw (SDException&);
+                /**
+                 * formats feature rows of one image into training lines or binary rows, when outputAll
+                 * is false rows with label 0 and 1 are taken alternately. Rows with other labels
+                 * (mask values other than 0 and 255) are skipped in both formats
+                 * @return
+                 * number of skipped rows
+                 */
+                size_t formatImage(const core::util::Matrix<float>* processed, int dimension, int pixelNum,
+                                    bool outputAll, bool binary, ImageChunk& chunk);
+                /**
+                 * writes formatted images in input order, starting from nextToWrite
+                 * up to first image which is not processed yet
+                 */
+                void writeReadyChunks(std::fstream& file, BinaryTrainingSetWriter* writer, std::vector<ImageChunk>& chunks,
+                                        size_t& nextToWrite, bool& first) throw (SDException&);
+                /**
+                 * images are processed by OpenMP threads, thread which finishes image writes
+                 * all images ready in input order, so output does not depend on thread count.
+                 * Number of formatted images waiting for write is limited by thread count.
+                 * Without deduplication old output.weights is removed.
+                 * Singletons and image parameters of each thread are created before threads start
+                 */
                 void processImages(std::string output, bool outputAll) throw (SDException&);
-                core::util::Matrix<float>* processImage(std::string orImage, std::string maskImage, int& rowDimesion, int& pixelNum);
+                static inline uint32_t colorKey(const uchar* bgr, uchar maskValue){
+                    return ((uint32_t)bgr[0] << 24) | ((uint32_t)bgr[1] << 16) | ((uint32_t)bgr[2] << 8) | maskValue;
+                }
+                /**
+                 * counts (color, mask value) pairs of all or sampled pixels of image
+                 */
+                void countColors(std::string orImage, std::string maskImage, uint imageIndex,
+                                    const TrainingSampler& sampler, ColorCounts& counts) throw (SDException&);
+                /**
+                 * features are function of pixel color only, so each unique (color, label) pair is written
+                 * once and number of pixels is written as instance weight, one per line in output.weights
+                 */
+                void writeDeduplicated(const ColorCounts& counts, const std::string& output, std::fstream& file,
+                                        BinaryTrainingSetWriter* writer, bool& first) throw (SDException&);
+                /**
+                 * features of image pixels with label in first column, only for sampled pixels when
+                 * sampling is turned on
+                 * @param ip
+                 * image parameters owned by calling thread
+                 */
+                core::util::Matrix<float>* processImage(std::string orImage, std::string maskImage, uint imageIndex,
+                                                        const TrainingSampler& sampler, core::tools::image::IImageParameteres& ip,
+                                                        int& rowDimesion, int& pixelNum);
             protected:
             public:
                 TrainingSet();
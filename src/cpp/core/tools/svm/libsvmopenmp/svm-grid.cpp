@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <random>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include "svm-grid.h"
+#include "core/util/Config.h"
+#if defined _OPENMP_MY
+#include <omp.h>
+#endif
+
+namespace core{
+    namespace tools{
+        namespace svm{
+            namespace libsvmopenmp {
+
+                using namespace std;
+                using namespace core::util;
+
+                // powers of two from log2 range, values are ascending
+                static void log2_range(const string& prefix, vector<double>& values) throw (SDException&) {
+                    Config* conf = Config::getInstancePtr();
+                    double min = atof(conf->getPropertyValue(prefix + "Min").c_str());
+                    double max = atof(conf->getPropertyValue(prefix + "Max").c_str());
+                    double step = atof(conf->getPropertyValue(prefix + "Step").c_str());
+                    if (step <= 0 || min > max) {
+                        SDException exc(SHADOW_OUT_OF_BOUNDS, "GridSearch::init");
+                        throw exc;
+                    }
+                    values.clear();
+                    for (int i = 0; min + i * step <= max + 1e-9; i++)
+                        values.push_back(pow(2., min + i * step));
+                }
+
+                GridSearch::GridSearch(const struct svm_problem* prob, const struct svm_parameter* param) throw (SDException&){
+                    this->prob = prob;
+                    this->param = *param;
+                    this->param.probability = 0;
+                    //solver output of concurrent trainings is not printed
+                    this->param.quiet = 1;
+                    best = -1;
+                    init();
+                    makeFolds();
+                }
+
+                GridSearch::~GridSearch(){
+                }
+
+                void GridSearch::init() throw (SDException&){
+                    if (param.svm_type != C_SVC && param.svm_type != EPSILON_SVR && param.svm_type != NU_SVR) {
+                        SDException exc(SHADOW_INALID_SVM_TYPE, "GridSearch::init");
+                        throw exc;
+                    }
+                    regression = param.svm_type != C_SVC;
+                    Config* conf = Config::getInstancePtr();
+                    log2_range("general.Training.GridSearch.log2C", cValues);
+                    //gamma is not used by linear and precomputed kernel
+                    if (param.kernel_type == LINEAR || param.kernel_type == PRECOMPUTED)
+                        gammaValues.assign(1, param.gamma);
+                    else
+                        log2_range("general.Training.GridSearch.log2Gamma", gammaValues);
+                    string strVal = conf->getPropertyValue("general.Training.GridSearch.folds");
+                    nr_fold = atoi(strVal.c_str());
+                    strVal = conf->getPropertyValue("general.Training.GridSearch.seed");
+                    seed = (uint)atoi(strVal.c_str());
+                    strVal = conf->getPropertyValue("general.Training.GridSearch.patience");
+                    patience = atoi(strVal.c_str());
+                    strVal = conf->getPropertyValue("general.Training.GridSearch.minImprovement");
+                    minImprovement = atof(strVal.c_str());
+                    if (nr_fold < 2 || nr_fold > prob->l || patience < 0 || minImprovement < 0) {
+                        SDException exc(SHADOW_OUT_OF_BOUNDS, "GridSearch::init");
+                        throw exc;
+                    }
+
+                    points.resize(gammaValues.size() * cValues.size());
+                    for (size_t g = 0; g < gammaValues.size(); g++) {
+                        for (size_t c = 0; c < cValues.size(); c++) {
+                            GridPoint& point = points[g * cValues.size() + c];
+                            point.C = cValues[c];
+                            point.gamma = gammaValues[g];
+                            point.score = 0;
+                            point.evaluated = false;
+                        }
+                    }
+                }
+
+                void GridSearch::makeFolds(){
+                    //instances of each label are shuffled and dealt to folds in turn,
+                    //regression has one group
+                    map< double, vector<int> > groups;
+                    for (int i = 0; i < prob->l; i++)
+                        groups[regression ? 0. : prob->y[i]].push_back(i);
+                    mt19937 rng(seed);
+                    vector<int> foldOf(prob->l);
+                    int next = 0;
+                    for (map< double, vector<int> >::iterator it = groups.begin(); it != groups.end(); it++) {
+                        vector<int>& group = it->second;
+                        for (size_t k = group.size(); k > 1; k--){
+                            uniform_int_distribution<size_t> distribution(0, k - 1);
+                            swap(group[k - 1], group[distribution(rng)]);
+                        }
+                        for (size_t k = 0; k < group.size(); k++) {
+                            foldOf[group[k]] = next;
+                            next = (next + 1) % nr_fold;
+                        }
+                    }
+
+                    folds.resize(nr_fold);
+                    for (int i = 0; i < prob->l; i++) {
+                        for (int f = 0; f < nr_fold; f++) {
+                            if (foldOf[i] == f)
+                                folds[f].test.push_back(i);
+                            else
+                                folds[f].train.push_back(i);
+                        }
+                    }
+                    for (int f = 0; f < nr_fold; f++) {
+                        Fold& fold = folds[f];
+                        for (size_t k = 0; k < fold.train.size(); k++) {
+                            fold.x.push_back(prob->x[fold.train[k]]);
+                            fold.y.push_back(prob->y[fold.train[k]]);
+                            if (prob->W != NULL)
+                                fold.W.push_back(prob->W[fold.train[k]]);
+                        }
+                        fold.prob.l = (int)fold.train.size();
+                        fold.prob.x = &fold.x[0];
+                        fold.prob.y = &fold.y[0];
+                        fold.prob.W = (prob->W != NULL) ? &fold.W[0] : NULL;
+                        fold.prob.source = prob->source;
+                    }
+                }
+
+                double GridSearch::score(const vector<double>& target) const{
+                    //held out rows count with their instance weights
+                    double result = 0;
+                    double sumW = 0;
+                    for (int i = 0; i < prob->l; i++) {
+                        double w = (prob->W != NULL) ? prob->W[i] : 1.;
+                        sumW += w;
+                        if (regression)
+                            result += w * (target[i] - prob->y[i]) * (target[i] - prob->y[i]);
+                        else if (target[i] == prob->y[i])
+                            result += w;
+                    }
+                    return regression ? result / sumW : 100. * result / sumW;
+                }
+
+                bool GridSearch::better(double a, double b, double margin) const{
+                    return regression ? a < b - margin : a > b + margin;
+                }
+
+                void GridSearch::searchGamma(int g, int foldThreads, int kernelThreads, double cacheSize){
+                    struct svm_parameter chainParam = param;
+                    chainParam.gamma = gammaValues[g];
+                    chainParam.cache_size = cacheSize;
+                    //alphas of each fold from previous C, empty before first one
+                    bool warm = param.svm_type == C_SVC;
+                    vector< vector<double> > alphas(nr_fold);
+                    vector<double> target(prob->l);
+                    double previousC = 0;
+                    double chainBest = 0;
+                    int sinceBest = 0;
+                    for (size_t c = 0; c < cValues.size(); c++) {
+                        chainParam.C = cValues[c];
+                        int f;
+#if defined _OPENMP_MY && !defined _OPENCL
+#pragma omp parallel for private(f) num_threads(foldThreads) schedule(dynamic, 1)
+#endif
+                        for (f = 0; f < nr_fold; f++) {
+#if defined _OPENMP_MY && !defined _OPENCL
+                            omp_set_num_threads(kernelThreads);
+#endif
+                            const Fold& fold = folds[f];
+                            vector<double>& alpha = alphas[f];
+                            vector<double> init;
+                            if (warm && alpha.empty() == false) {
+                                init.resize(alpha.size());
+                                for (size_t k = 0; k < alpha.size(); k++)
+                                    init[k] = alpha[k] * chainParam.C / previousC;
+                            }
+                            alpha.resize(fold.train.size());
+                            struct svm_model *model = svm_train_warm_start(&fold.prob, &chainParam,
+                                    init.empty() ? NULL : &init[0], &alpha[0]);
+                            //held out rows of problem with row source are expanded here
+                            vector<struct svm_node> row((prob->source != NULL) ? prob->source->dim + 1 : 1);
+                            for (size_t k = 0; k < fold.test.size(); k++)
+                                target[fold.test[k]] = svm_predict(model, svm_problem_row(prob, fold.test[k], &row[0]));
+                            svm_free_and_destroy_model(&model);
+                        }
+                        previousC = chainParam.C;
+
+                        GridPoint& point = points[g * cValues.size() + c];
+                        point.score = score(target);
+                        point.evaluated = true;
+                        printf("C = %g, gamma = %g, %s = %g\n", point.C, point.gamma,
+                                regression ? "mean squared error" : "accuracy", point.score);
+                        if (c == 0 || better(point.score, chainBest, minImprovement)) {
+                            chainBest = point.score;
+                            sinceBest = 0;
+                        }
+                        else if (patience > 0 && ++sinceBest >= patience)
+                            break;
+                    }
+                }
+
+                void GridSearch::run(){
+                    int gammaThreads = 1;
+                    int foldThreads = 1;
+                    int kernelThreads = 1;
+                    //OpenCL kernel evaluation goes through one shared device context, there chains stay sequential
+#if defined _OPENMP_MY && !defined _OPENCL
+                    int threads = omp_get_max_threads();
+                    gammaThreads = max(1, min((int)gammaValues.size(), threads));
+                    foldThreads = max(1, min(nr_fold, threads / gammaThreads));
+                    kernelThreads = max(1, threads / (gammaThreads * foldThreads));
+                    int levels = omp_get_max_active_levels();
+                    if (levels < 3)
+                        omp_set_max_active_levels(3);
+#endif
+                    cout << "Grid search: " << cValues.size() << " C x " << gammaValues.size() << " gamma, "
+                         << nr_fold << " folds, threads " << gammaThreads << " x " << foldThreads
+                         << " x " << kernelThreads << endl;
+                    //every training at the same time gets part of kernel cache
+                    double cacheSize = param.cache_size / (gammaThreads * foldThreads);
+
+                    int g;
+#if defined _OPENMP_MY && !defined _OPENCL
+#pragma omp parallel for private(g) num_threads(gammaThreads) schedule(dynamic, 1)
+#endif
+                    for (g = 0; g < (int)gammaValues.size(); g++) {
+                        searchGamma(g, foldThreads, kernelThreads, cacheSize);
+                    }
+#if defined _OPENMP_MY && !defined _OPENCL
+                    omp_set_max_active_levels(levels);
+#endif
+
+                    best = -1;
+                    for (size_t i = 0; i < points.size(); i++) {
+                        if (points[i].evaluated && (best < 0 || better(points[i].score, points[best].score, 0)))
+                            best = (int)i;
+                    }
+                    printf("Best C = %g, gamma = %g, %s = %g\n", getBestC(), getBestGamma(),
+                            regression ? "mean squared error" : "accuracy", getBestScore());
+                }
+
+                void GridSearch::writeResults(const char* file) const throw (SDException&){
+                    FILE* fp = fopen(file, "w");
+                    if (fp == NULL) {
+                        SDException exc(SHADOW_WRITE_UNABLE, "GridSearch::writeResults");
+                        throw exc;
+                    }
+                    fprintf(fp, "C\tgamma\t%s\n", regression ? "mse" : "accuracy");
+                    for (size_t i = 0; i < points.size(); i++) {
+                        if (points[i].evaluated)
+                            fprintf(fp, "%g\t%g\t%g\n", points[i].C, points[i].gamma, points[i].score);
+                        else
+                            fprintf(fp, "%g\t%g\tskipped\n", points[i].C, points[i].gamma);
+                    }
+                    fclose(fp);
+                }
+
+                double GridSearch::getBestC() const{
+                    return points[best].C;
+                }
+
+                double GridSearch::getBestGamma() const{
+                    return points[best].gamma;
+                }
+
+                double GridSearch::getBestScore() const{
+                    return points[best].score;
+                }
+
+            }
+        }
+    }
+}
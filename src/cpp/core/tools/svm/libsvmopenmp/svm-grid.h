@@ -0,0 +1,96 @@
+#ifndef __SVM_GRID_H__
+#define __SVM_GRID_H__
+
+#include <vector>
+#include <string>
+#include "thirdparty/lib_svm/svm.h"
+#include "typedefs.h"
+
+namespace core{
+        namespace tools {
+            namespace svm {
+                namespace libsvmopenmp {
+                    /**
+                     * cross validated search over (C, gamma) grid on one loaded problem.
+                     * Folds are stratified by label and built once from seed. Each gamma is one chain
+                     * walking C upwards, every fold starts from its alphas of previous C scaled by
+                     * C ratio (C-SVC only). Chain stops after patience steps without improvement
+                     * of minImprovement, rest of its points are skipped. Gamma chains and folds
+                     * are trained in parallel, results do not depend on thread count.
+                     * Scores weight every held out row by its instance weight. On deduplicated set
+                     * one row is one unique color, so folds are split by color: pixels of one color
+                     * are never in training and held out part at the same time.
+                     * Configured in general.Training.GridSearch
+                     */
+                    class GridSearch{
+                    private:
+                        struct GridPoint{
+                            double C;
+                            double gamma;
+                            //accuracy in percents for classification, mean squared error for regression
+                            double score;
+                            bool evaluated;
+                        };
+                        struct Fold{
+                            struct svm_problem prob;
+                            std::vector<struct svm_node*> x;
+                            std::vector<double> y;
+                            std::vector<double> W;
+                            //instances of training part and held out part
+                            std::vector<int> train;
+                            std::vector<int> test;
+                        };
+
+                        const struct svm_problem* prob;
+                        struct svm_parameter param;
+                        bool regression;
+                        std::vector<double> cValues;
+                        std::vector<double> gammaValues;
+                        //gamma major, C ascending
+                        std::vector<GridPoint> points;
+                        std::vector<Fold> folds;
+                        int nr_fold;
+                        uint seed;
+                        int patience;
+                        double minImprovement;
+                        int best;
+
+                        void init() throw (SDException&);
+                        void makeFolds();
+                        void searchGamma(int g, int foldThreads, int kernelThreads, double cacheSize);
+                        double score(const std::vector<double>& target) const;
+                        bool better(double a, double b, double margin) const;
+                    protected:
+                    public:
+                        /**
+                         * @param prob
+                         * loaded problem, has to live until search ends
+                         * @param param
+                         * parameters of training, C and gamma are searched
+                         */
+                        GridSearch(const struct svm_problem* prob, const struct svm_parameter* param) throw (SDException&);
+                        virtual ~GridSearch();
+
+                        /**
+                         * evaluates grid, prints result of each point and best point
+                         */
+                        void run();
+                        /**
+                         * writes tab separated table: C, gamma and score or "skipped"
+                         * @param file
+                         */
+                        void writeResults(const char* file) const throw (SDException&);
+                        /**
+                         * best point is first one with highest accuracy (lowest error)
+                         * in gamma major, C ascending order
+                         */
+                        double getBestC() const;
+                        double getBestGamma() const;
+                        double getBestScore() const;
+                    };
+                }
+            }
+        }
+}
+
+#endif
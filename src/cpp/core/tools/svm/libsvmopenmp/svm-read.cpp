@@ -0,0 +1,363 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "svm-read.h"
+#if defined _OPENMP_MY
+#include <omp.h>
+#endif
+
+#define Malloc(type,n) (type *)malloc((n)*sizeof(type))
+//smallest part of file parsed by one thread
+#define READ_MIN_CHUNK_SIZE (1 << 20)
+
+namespace core{
+    namespace tools{
+        namespace svm{
+            namespace libsvmopenmp {
+
+                using namespace std;
+
+                /**
+                 * rows parsed from one part of file
+                 */
+                struct ProblemChunk{
+                    const char* begin;
+                    const char* end;
+                    vector<double> labels;
+                    vector<size_t> lineStarts;
+                    vector<struct svm_node> nodes;
+                    int maxIndex;
+                    //first invalid line inside chunk, -1 if none
+                    int errorLine;
+                };
+
+                //powers of ten exactly representable in double
+                static const double exactPowers[] = {
+                    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+                };
+
+                static inline bool isBlank(char c){
+                    return c == ' ' || c == '\t';
+                }
+
+                /**
+                 * strtod on copy of token, for values fast path does not handle
+                 */
+                static bool parseDoubleSlow(const char* begin, const char* end, bool allowTrailingSpace, double& value){
+                    string token(begin, end);
+                    char* endptr;
+                    errno = 0;
+                    value = strtod(token.c_str(), &endptr);
+                    if (endptr == token.c_str() || errno != 0)
+                        return false;
+                    if (*endptr != '\0' && (allowTrailingSpace == false || !isspace(*endptr)))
+                        return false;
+                    return true;
+                }
+
+                /**
+                 * parses decimal number. When mantissa fits in 53 bits and exponent is within exact
+                 * powers of ten single multiplication or division is correctly rounded, so result is
+                 * same as strtod. Other values fall back to strtod
+                 * @param allowTrailingSpace
+                 * when true whitespace is allowed after number as with libsvm feature values
+                 */
+                static bool parseDouble(const char* begin, const char* end, bool allowTrailingSpace, double& value){
+                    const char* p = begin;
+                    bool negative = false;
+                    if (p < end && (*p == '-' || *p == '+')){
+                        negative = *p == '-';
+                        p++;
+                    }
+                    uint64_t mantissa = 0;
+                    int digits = 0;
+                    int exponent = 0;
+                    bool anyDigit = false;
+                    while (p < end && *p >= '0' && *p <= '9'){
+                        if (mantissa != 0 || *p != '0')
+                            digits++;
+                        mantissa = mantissa * 10 + (*p - '0');
+                        anyDigit = true;
+                        p++;
+                        if (digits > 15)
+                            return parseDoubleSlow(begin, end, allowTrailingSpace, value);
+                    }
+                    if (p < end && *p == '.'){
+                        p++;
+                        while (p < end && *p >= '0' && *p <= '9'){
+                            if (mantissa != 0 || *p != '0')
+                                digits++;
+                            mantissa = mantissa * 10 + (*p - '0');
+                            exponent--;
+                            anyDigit = true;
+                            p++;
+                            if (digits > 15)
+                                return parseDoubleSlow(begin, end, allowTrailingSpace, value);
+                        }
+                    }
+                    if (anyDigit == false)
+                        return parseDoubleSlow(begin, end, allowTrailingSpace, value);
+                    if (p < end && (*p == 'e' || *p == 'E')){
+                        p++;
+                        bool expNegative = false;
+                        if (p < end && (*p == '-' || *p == '+')){
+                            expNegative = *p == '-';
+                            p++;
+                        }
+                        if (p >= end || *p < '0' || *p > '9')
+                            return parseDoubleSlow(begin, end, allowTrailingSpace, value);
+                        int expValue = 0;
+                        while (p < end && *p >= '0' && *p <= '9'){
+                            expValue = expValue * 10 + (*p - '0');
+                            p++;
+                            if (expValue > 1000)
+                                return parseDoubleSlow(begin, end, allowTrailingSpace, value);
+                        }
+                        exponent += expNegative ? -expValue : expValue;
+                    }
+                    for (const char* q = p; q < end; q++){
+                        if (allowTrailingSpace == false || !isspace(*q))
+                            return parseDoubleSlow(begin, end, allowTrailingSpace, value);
+                    }
+                    if (exponent < -22 || exponent > 22)
+                        return parseDoubleSlow(begin, end, allowTrailingSpace, value);
+                    double result = (double)mantissa;
+                    if (exponent < 0)
+                        result /= exactPowers[-exponent];
+                    else
+                        result *= exactPowers[exponent];
+                    value = negative ? -result : result;
+                    return true;
+                }
+
+                /**
+                 * same rules as strtol on index token, which must end exactly before ':'
+                 */
+                static bool parseIndex(const char* begin, const char* end, int& index){
+                    const char* p = begin;
+                    while (p < end && isspace(*p))
+                        p++;
+                    long result = 0;
+                    const char* digitsBegin = p;
+                    while (p < end && *p >= '0' && *p <= '9' && p - digitsBegin < 9){
+                        result = result * 10 + (*p - '0');
+                        p++;
+                    }
+                    if (p == end && p != digitsBegin){
+                        index = (int)result;
+                        return true;
+                    }
+                    //signs, long numbers and invalid tokens
+                    string token(begin, end);
+                    char* endptr;
+                    errno = 0;
+                    result = strtol(token.c_str(), &endptr, 10);
+                    if (endptr == token.c_str() || errno != 0 || *endptr != '\0')
+                        return false;
+                    index = (int)result;
+                    return true;
+                }
+
+                /**
+                 * parses one line the way libsvm strtok parsing does
+                 * @param hasNewline
+                 * false only for last line of file without trailing newline
+                 * @return
+                 * false if line is invalid
+                 */
+                static bool parseLine(const char* begin, const char* end, bool hasNewline, ProblemChunk& chunk){
+                    const char* p = begin;
+                    while (p < end && isBlank(*p))
+                        p++;
+                    const char* labelBegin = p;
+                    while (p < end && isBlank(*p) == false)
+                        p++;
+                    //empty line
+                    if (labelBegin == p)
+                        return false;
+                    double label;
+                    if (parseDouble(labelBegin, p, false, label) == false)
+                        return false;
+
+                    int instMaxIndex = -1;
+                    if (p < end)
+                        p++;
+                    while (true){
+                        //index token is everything up to ':', value token is delimited by blanks
+                        while (p < end && *p == ':')
+                            p++;
+                        const char* idxBegin = p;
+                        const char* colon = (const char*)memchr(p, ':', end - p);
+                        if (colon == 0)
+                            break;
+                        p = colon + 1;
+                        while (p < end && isBlank(*p))
+                            p++;
+                        const char* valBegin = p;
+                        while (p < end && isBlank(*p) == false)
+                            p++;
+                        //libsvm gets "\n" as value and strtod rejects it, only at end of file value is missing
+                        if (valBegin == p){
+                            if (hasNewline)
+                                return false;
+                            break;
+                        }
+
+                        struct svm_node node;
+                        if (parseIndex(idxBegin, colon, node.index) == false || node.index <= instMaxIndex)
+                            return false;
+                        instMaxIndex = node.index;
+                        if (parseDouble(valBegin, p, true, node.value) == false)
+                            return false;
+                        chunk.nodes.push_back(node);
+                        if (p < end)
+                            p++;
+                    }
+
+                    if (instMaxIndex > chunk.maxIndex)
+                        chunk.maxIndex = instMaxIndex;
+                    struct svm_node last;
+                    last.index = -1;
+                    last.value = 0.;
+                    chunk.nodes.push_back(last);
+                    chunk.labels.push_back(label);
+                    return true;
+                }
+
+                static void parseChunk(ProblemChunk& chunk){
+                    const char* p = chunk.begin;
+                    int line = 0;
+                    while (p < chunk.end){
+                        const char* lineEnd = (const char*)memchr(p, '\n', chunk.end - p);
+                        if (lineEnd == 0)
+                            lineEnd = chunk.end;
+                        chunk.lineStarts.push_back(chunk.nodes.size());
+                        if (parseLine(p, lineEnd, lineEnd < chunk.end, chunk) == false){
+                            chunk.errorLine = line;
+                            return;
+                        }
+                        line++;
+                        p = lineEnd + 1;
+                    }
+                }
+
+                int read_text_problem(const char* filename, struct svm_problem* prob, struct svm_node** x_space,
+                                        int* max_index) throw (SDException&){
+                    int fd = open(filename, O_RDONLY);
+                    if (fd < 0){
+                        SDException exc(SHADOW_READ_UNABLE, "read_text_problem");
+                        throw exc;
+                    }
+                    struct stat fileStat;
+                    if (fstat(fd, &fileStat) != 0){
+                        close(fd);
+                        SDException exc(SHADOW_READ_UNABLE, "read_text_problem");
+                        throw exc;
+                    }
+                    size_t size = fileStat.st_size;
+                    const char* data = 0;
+                    if (size > 0){
+                        void* mapped = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                        if (mapped == MAP_FAILED){
+                            close(fd);
+                            SDException exc(SHADOW_READ_UNABLE, "read_text_problem");
+                            throw exc;
+                        }
+                        madvise(mapped, size, MADV_SEQUENTIAL);
+                        data = (const char*)mapped;
+                    }
+
+#if defined _OPENMP_MY
+                    int chunkCount = omp_get_max_threads();
+#else
+                    int chunkCount = 1;
+#endif
+                    chunkCount = (int)min((size_t)chunkCount, size / READ_MIN_CHUNK_SIZE + 1);
+                    vector<ProblemChunk> chunks(chunkCount);
+                    const char* chunkBegin = data;
+                    for (int c = 0; c < chunkCount; c++){
+                        const char* chunkEnd = data + size * (c + 1) / chunkCount;
+                        if (chunkEnd < chunkBegin)
+                            chunkEnd = chunkBegin;
+                        //move split after end of line
+                        if (c < chunkCount - 1 && chunkEnd > data && chunkEnd < data + size && chunkEnd[-1] != '\n'){
+                            const char* lineEnd = (const char*)memchr(chunkEnd, '\n', data + size - chunkEnd);
+                            chunkEnd = (lineEnd == 0) ? data + size : lineEnd + 1;
+                        }
+                        chunks[c].begin = chunkBegin;
+                        chunks[c].end = chunkEnd;
+                        chunks[c].maxIndex = 0;
+                        chunks[c].errorLine = -1;
+                        chunkBegin = chunkEnd;
+                    }
+
+                    int c;
+#if defined _OPENMP_MY
+#pragma omp parallel for private(c)
+#endif
+                    for (c = 0; c < chunkCount; c++){
+                        parseChunk(chunks[c]);
+                    }
+
+                    if (data != 0)
+                        munmap((void*)data, size);
+                    close(fd);
+
+                    //first error in file order, same line as sequential parsing reports
+                    int lines = 0;
+                    size_t elements = 0;
+                    *max_index = 0;
+                    for (c = 0; c < chunkCount; c++){
+                        if (chunks[c].errorLine >= 0)
+                            return lines + chunks[c].errorLine + 1;
+                        lines += (int)chunks[c].labels.size();
+                        elements += chunks[c].nodes.size();
+                        *max_index = max(*max_index, chunks[c].maxIndex);
+                    }
+
+                    prob->l = lines;
+                    prob->W = NULL;
+                    prob->y = Malloc(double, lines);
+                    prob->x = Malloc(struct svm_node *, lines);
+                    *x_space = Malloc(struct svm_node, elements);
+                    if ((lines > 0 && (prob->y == NULL || prob->x == NULL)) || (elements > 0 && *x_space == NULL)){
+                        SDException exc(SHADOW_NO_MEM, "read_text_problem");
+                        throw exc;
+                    }
+
+                    vector<int> firstLines(chunkCount, 0);
+                    vector<size_t> firstElements(chunkCount, 0);
+                    for (c = 1; c < chunkCount; c++){
+                        firstLines[c] = firstLines[c - 1] + (int)chunks[c - 1].labels.size();
+                        firstElements[c] = firstElements[c - 1] + chunks[c - 1].nodes.size();
+                    }
+#if defined _OPENMP_MY
+#pragma omp parallel for private(c)
+#endif
+                    for (c = 0; c < chunkCount; c++){
+                        ProblemChunk& chunk = chunks[c];
+                        struct svm_node* nodes = *x_space + firstElements[c];
+                        if (chunk.nodes.empty() == false)
+                            memcpy(nodes, &chunk.nodes[0], chunk.nodes.size() * sizeof(struct svm_node));
+                        for (size_t i = 0; i < chunk.labels.size(); i++){
+                            prob->y[firstLines[c] + i] = chunk.labels[i];
+                            prob->x[firstLines[c] + i] = nodes + chunk.lineStarts[i];
+                        }
+                        vector<struct svm_node>().swap(chunk.nodes);
+                    }
+                    return 0;
+                }
+
+            }
+        }
+    }
+}
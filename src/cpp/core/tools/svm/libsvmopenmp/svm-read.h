@@ -0,0 +1,32 @@
+#ifndef __SVM_READ_H__
+#define __SVM_READ_H__
+
+#include "thirdparty/lib_svm/svm.h"
+#include "typedefs.h"
+
+namespace core{
+        namespace tools {
+            namespace svm {
+                namespace libsvmopenmp {
+                    /**
+                     * parses libsvm text training set. File is memory mapped and split on line boundaries,
+                     * each thread parses own part, so file is read only once. Accepts and rejects same lines
+                     * as libsvm read_problem
+                     * @param filename
+                     * @param prob
+                     * filled problem, y and x are allocated with malloc
+                     * @param x_space
+                     * nodes of all rows, allocated with malloc
+                     * @param max_index
+                     * largest feature index
+                     * @return
+                     * 0 on success, otherwise number of first invalid line
+                     */
+                    int read_text_problem(const char* filename, struct svm_problem* prob, struct svm_node** x_space,
+                                            int* max_index) throw (SDException&);
+                }
+            }
+        }
+}
+
+#endif
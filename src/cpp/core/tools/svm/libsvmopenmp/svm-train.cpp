@@ -3,10 +3,14 @@
 #include <string.h>
 #include <ctype.h>
 #include <errno.h>
+#include <unistd.h>
 #include <iostream>
 #include "svm-train.h"
+#include "svm-read.h"
+#include "svm-grid.h"
 #include "core/util/Config.h"
 #include "core/opencl/libsvm/OpenCLToolsTrain.h"
+#include "core/tools/svm/BinaryTrainingSet.h"
 
 
 #define Malloc(type,n) (type *)malloc((n)*sizeof(type))
@@ -30,45 +34,44 @@ namespace core{
                     exit(1);
                 }
 
-                void parse_command_line(int argc, char **argv, char *input_file_name, char *model_file_name);
-                void read_problem(const char *filename);
-                void do_cross_validation();
-
-                struct svm_parameter param; // set by parse_command_line
-                struct svm_problem prob; // set by read_problem
-                struct svm_model *model;
-                struct svm_node *x_space;
-                int cross_validation;
-                int nr_fold;
-
-                static char *line = NULL;
-                static int max_line_len;
+                // kernel cache size in MB, value is either MB or percentage of physical memory ("25%")
+                double cache_size_mb(const string& value) throw (SDException&) {
+                    double size = atof(value.c_str());
+                    if (value.find('%') != string::npos) {
+                        double memory = (double) sysconf(_SC_PHYS_PAGES) * (double) sysconf(_SC_PAGE_SIZE);
+                        size = memory * size / 100. / (1 << 20);
+                    }
+                    if (size <= 0) {
+                        SDException exc(SHADOW_OUT_OF_BOUNDS, "cache_size_mb");
+                        throw exc;
+                    }
+                    return size;
+                }
 
-                static char* readline(FILE *input) {
-                    int len;
+                TrainingContext::TrainingContext(){
+                    memset(&param, 0, sizeof(param));
+                    memset(&prob, 0, sizeof(prob));
+                    memset(&rowSource, 0, sizeof(rowSource));
+                    x_space = NULL;
+                    nr_fold = 0;
+                }
 
-                    if (fgets(line, max_line_len, input) == NULL)
-                        return NULL;
+                TrainingContext::~TrainingContext(){
+                    free_problem();
+                    svm_destroy_param(&param);
+                }
 
-                    while (strrchr(line, '\n') == NULL) {
-                        max_line_len *= 2;
-                        line = (char *) realloc(line, max_line_len);
-                        len = (int) strlen(line);
-                        if (fgets(line + len, max_line_len - len, input) == NULL)
-                            break;
-                    }
-                    return line;
+                void TrainingContext::free_problem() {
+                    free(prob.y);
+                    free(prob.x);
+                    free(prob.W);
+                    free(x_space);
+                    memset(&prob, 0, sizeof(prob));
+                    x_space = NULL;
+                    binarySet.close();
                 }
 
-                int train(char* input_file_name, char* model_file_name) throw(SDException&){
-                    cout << "Start training" << endl;
-#ifdef _OPENCL
-                    OpenCLToolsTrain* oclt = OpenCLToolsTrain::getInstancePtr();
-                    if (oclt->hasInitialized() == false){
-                        SDException exc(SHADOW_OPENCL_TOOLS_NOT_INITIALIZED, "libsvm train");
-                        throw exc;
-                    }
-#endif
+                void TrainingContext::read_parameters() throw (SDException&) {
                     Config* conf = Config::getInstancePtr();
                     
                     param.svm_type = C_SVC;
@@ -86,9 +89,10 @@ namespace core{
                     param.nr_weight = 0;
                     param.weight_label = NULL;
                     param.weight = NULL;
-                    cross_validation = 0;
+                    param.fold_threads = 0;
+                    param.quiet = 0;
                     
-                    string strVal = conf->getPropertyValue("settings.svm.svm_type");
+                    string strVal = conf->getPropertyValue("general.Training.svm.svm_type");
                     int val = atoi(strVal.c_str());
                     if (val >= 0 && val < 5)
                         param.svm_type = val;
@@ -96,7 +100,7 @@ namespace core{
                         SDException e(SHADOW_INALID_SVM_TYPE, "train");
                         throw e;
                     }
-                    strVal = conf->getPropertyValue("settings.svm.kernel_type");
+                    strVal = conf->getPropertyValue("general.Training.svm.kernel_type");
                     val = atoi(strVal.c_str());
                     if (val >= 0 && val < 4)
                         param.kernel_type = val;
@@ -104,25 +108,53 @@ namespace core{
                         SDException e(SHADOW_INVALID_KERNEL_TYPE, "train");
                         throw e;
                     }
+                    //empty value keeps default cache size
+                    strVal = conf->getPropertyValue("general.Training.svm.cacheSize");
+                    if (strVal.empty() == false)
+                        param.cache_size = cache_size_mb(strVal);
+                    strVal = conf->getPropertyValue("general.Training.svm.crossValidation");
+                    nr_fold = atoi(strVal.c_str());
+                    strVal = conf->getPropertyValue("general.Training.svm.foldThreads");
+                    param.fold_threads = atoi(strVal.c_str());
+                    if (nr_fold < 0 || nr_fold == 1 || param.fold_threads < 0){
+                        SDException e(SHADOW_OUT_OF_BOUNDS, "train");
+                        throw e;
+                    }
+                }
+
+                int TrainingContext::train(const char* input_file_name, const char* model_file_name) throw(SDException&){
+                    cout << "Start training" << endl;
+#ifdef _OPENCL
+                    OpenCLToolsTrain* oclt = OpenCLToolsTrain::getInstancePtr();
+                    if (oclt->hasInitialized() == false){
+                        SDException exc(SHADOW_OPENCL_TOOLS_NOT_INITIALIZED, "libsvm train");
+                        throw exc;
+                    }
+#endif
+                    read_parameters();
                     
                     void (*print_func)(const char*) = NULL;	// default printing to stdout
                     svm_set_print_string_function(print_func);
                                         
                     cout << "Start read problem" << endl;
                     read_problem(input_file_name);
+                    read_weights(input_file_name);
                     cout << "Finished read problem" << endl;
-                    model = svm_train(&prob, &param);
-                    if (svm_save_model(model_file_name, model)) {
-                        fprintf(stderr, "can't save model to file %s\n", model_file_name);
+                    const char* error_msg = svm_check_parameter(&prob, &param);
+                    if (error_msg) {
+                        fprintf(stderr, "ERROR: %s\n", error_msg);
                         exit(1);
                     }
-                    svm_free_and_destroy_model(&model);
-
-                    svm_destroy_param(&param);
-                    free(prob.y);
-                    free(prob.x);
-                    free(x_space);
-                    free(line);
+                    if (nr_fold > 0) {
+                        do_cross_validation();
+                    } else {
+                        struct svm_model *model = svm_train(&prob, &param);
+                        if (svm_save_model(model_file_name, model)) {
+                            fprintf(stderr, "can't save model to file %s\n", model_file_name);
+                            exit(1);
+                        }
+                        svm_free_and_destroy_model(&model);
+                    }
 
 #ifdef _OPENCL                                        
                     cout << "data durr: " << oclt->durrData << " buff durr: " << oclt->durrBuff << " durr exec: " << oclt->durrExec;
@@ -132,116 +164,186 @@ namespace core{
                     return 0;
                 }
 
-                void do_cross_validation() {
+                double TrainingContext::do_cross_validation() {
                     int i;
-                    int total_correct = 0;
+                    double total_correct = 0;
                     double total_error = 0;
+                    //each held out row counts with its instance weight
+                    double sumw = 0;
                     double sumv = 0, sumy = 0, sumvv = 0, sumyy = 0, sumvy = 0;
                     double *target = Malloc(double, prob.l);
+                    double result;
 
                     svm_cross_validation(&prob, &param, nr_fold, target);
                     if (param.svm_type == EPSILON_SVR ||
                             param.svm_type == NU_SVR) {
                         for (i = 0; i < prob.l; i++) {
+                            double w = (prob.W != NULL) ? prob.W[i] : 1.;
                             double y = prob.y[i];
                             double v = target[i];
-                            total_error += (v - y)*(v - y);
-                            sumv += v;
-                            sumy += y;
-                            sumvv += v*v;
-                            sumyy += y*y;
-                            sumvy += v*y;
+                            sumw += w;
+                            total_error += w*(v - y)*(v - y);
+                            sumv += w*v;
+                            sumy += w*y;
+                            sumvv += w*v*v;
+                            sumyy += w*y*y;
+                            sumvy += w*v*y;
                         }
-                        printf("Cross Validation Mean squared error = %g\n", total_error / prob.l);
+                        result = total_error / sumw;
+                        printf("Cross Validation Mean squared error = %g\n", result);
                         printf("Cross Validation Squared correlation coefficient = %g\n",
-                                ((prob.l * sumvy - sumv * sumy)*(prob.l * sumvy - sumv * sumy)) /
-                                ((prob.l * sumvv - sumv * sumv)*(prob.l * sumyy - sumy * sumy))
+                                ((sumw * sumvy - sumv * sumy)*(sumw * sumvy - sumv * sumy)) /
+                                ((sumw * sumvv - sumv * sumv)*(sumw * sumyy - sumy * sumy))
                                 );
                     } else {
-                        for (i = 0; i < prob.l; i++)
+                        for (i = 0; i < prob.l; i++) {
+                            double w = (prob.W != NULL) ? prob.W[i] : 1.;
+                            sumw += w;
                             if (target[i] == prob.y[i])
-                                ++total_correct;
-                        printf("Cross Validation Accuracy = %g%%\n", 100.0 * total_correct / prob.l);
+                                total_correct += w;
+                        }
+                        result = 100.0 * total_correct / sumw;
+                        printf("Cross Validation Accuracy = %g%%\n", result);
                     }
                     free(target);
+                    return result;
                 }                
 
-                // read in a problem (in svmlight format)
-                void read_problem(const char *filename) {
-                    int elements, max_index, inst_max_index, i, j;
-                    FILE *fp = fopen(filename, "r");
-                    char *endptr;
-                    char *idx, *val, *label;
+                int TrainingContext::grid_search(const char* input_file_name, const char* model_file_name,
+                                                 const char* results_file_name) throw(SDException&){
+                    cout << "Start grid search" << endl;
+#ifdef _OPENCL
+                    OpenCLToolsTrain* oclt = OpenCLToolsTrain::getInstancePtr();
+                    if (oclt->hasInitialized() == false){
+                        SDException exc(SHADOW_OPENCL_TOOLS_NOT_INITIALIZED, "libsvm grid search");
+                        throw exc;
+                    }
+#endif
+                    read_parameters();
+                    
+                    cout << "Start read problem" << endl;
+                    read_problem(input_file_name);
+                    read_weights(input_file_name);
+                    cout << "Finished read problem" << endl;
+                    const char* error_msg = svm_check_parameter(&prob, &param);
+                    if (error_msg) {
+                        fprintf(stderr, "ERROR: %s\n", error_msg);
+                        exit(1);
+                    }
+                    GridSearch search(&prob, &param);
+                    search.run();
+                    search.writeResults(results_file_name);
 
-                    if (fp == NULL) {
-                        fprintf(stderr, "can't open input file %s\n", filename);
+                    param.C = search.getBestC();
+                    param.gamma = search.getBestGamma();
+                    struct svm_model *model = svm_train(&prob, &param);
+                    if (svm_save_model(model_file_name, model)) {
+                        fprintf(stderr, "can't save model to file %s\n", model_file_name);
                         exit(1);
                     }
+                    svm_free_and_destroy_model(&model);
+                    return 0;
+                }
+
+                int train(char* input_file_name, char* model_file_name) throw(SDException&){
+                    TrainingContext context;
+                    return context.train(input_file_name, model_file_name);
+                }
 
-                    prob.l = 0;
-                    elements = 0;
+                int grid_search(char* input_file_name, char* model_file_name, char* results_file_name) throw(SDException&){
+                    TrainingContext context;
+                    return context.grid_search(input_file_name, model_file_name, results_file_name);
+                }
 
-                    max_line_len = 1024;
-                    line = Malloc(char, max_line_len);
-                    while (readline(fp) != NULL) {
-                        char *p = strtok(line, " \t"); // label
+                // feature of binary training set for svm_row_source
+                static double binary_feature(const void *data, int row, int index) {
+                    return ((const BinaryTrainingSet *) data)->getFeature(row, index);
+                }
 
-                        // features
-                        while (1) {
-                            p = strtok(NULL, " \t");
-                            if (p == NULL || *p == '\n') // check '\n' as ' ' may be after the last feature
-                                break;
-                            ++elements;
-                        }
-                        ++elements;
-                        ++prob.l;
+                // read in a problem from memory mapped binary training set, features
+                // are not copied, kernel reads them through prob.source
+                void TrainingContext::read_binary_problem(const char *filename) throw (SDException&) {
+                    binarySet.open(filename);
+                    if (param.kernel_type == PRECOMPUTED) {
+                        fprintf(stderr, "Wrong input format: precomputed kernel needs text training set\n");
+                        exit(1);
                     }
-                    rewind(fp);
-
+                    int dimension = (int) binarySet.getDimension();
+                    prob.l = (int) binarySet.getRows();
+                    prob.W = NULL;
                     prob.y = Malloc(double, prob.l);
                     prob.x = Malloc(struct svm_node *, prob.l);
-                    x_space = Malloc(struct svm_node, elements);
+                    //OpenCL kernel works on svm_node rows, there features are expanded
+#ifdef _OPENCL
+                    int rowNodes = dimension + 1;
+#else
+                    int rowNodes = 1;
+                    rowSource.dim = dimension;
+                    rowSource.data = &binarySet;
+                    rowSource.get_value = &binary_feature;
+                    prob.source = &rowSource;
+#endif
+                    x_space = Malloc(struct svm_node, (size_t) prob.l * rowNodes);
+                    if (prob.y == NULL || prob.x == NULL || x_space == NULL) {
+                        SDException exc(SHADOW_NO_MEM, "read_binary_problem");
+                        throw exc;
+                    }
 
-                    max_index = 0;
-                    j = 0;
+                    int i;
+#if defined _OPENMP_MY
+#pragma omp parallel for private(i)
+#endif
                     for (i = 0; i < prob.l; i++) {
-                        inst_max_index = -1; // strtol gives 0 if wrong format, and precomputed kernel has <index> start from 0
-                        readline(fp);
-                        prob.x[i] = &x_space[j];
-                        label = strtok(line, " \t\n");
-                        if (label == NULL) // empty line
-                            exit_input_error(i + 1);
-
-                        prob.y[i] = strtod(label, &endptr);
-                        if (endptr == label || *endptr != '\0')
-                            exit_input_error(i + 1);
-
-                        while (1) {
-                            idx = strtok(NULL, ":");
-                            val = strtok(NULL, " \t");
-
-                            if (val == NULL)
-                                break;
-
-                            errno = 0;
-                            x_space[j].index = (int) strtol(idx, &endptr, 10);
-                            if (endptr == idx || errno != 0 || *endptr != '\0' || x_space[j].index <= inst_max_index)
-                                exit_input_error(i + 1);
-                            else
-                                inst_max_index = x_space[j].index;
+                        struct svm_node* nodes = &x_space[(size_t) i * rowNodes];
+#ifdef _OPENCL
+                        for (int j = 0; j < dimension; j++) {
+                            nodes[j].index = j + 1;
+                            nodes[j].value = binarySet.getFeature(i, j);
+                        }
+                        nodes[dimension].index = -1;
+#else
+                        nodes[0].index = -1;
+                        nodes[0].value = i;
+#endif
+                        prob.x[i] = nodes;
+                        prob.y[i] = binarySet.getLabel(i);
+                    }
 
-                            errno = 0;
-                            x_space[j].value = strtod(val, &endptr);
-                            if (endptr == val || errno != 0 || (*endptr != '\0' && !isspace(*endptr)))
-                                exit_input_error(i + 1);
+                    if (param.gamma == 0 && dimension > 0)
+                        param.gamma = 1.0 / dimension;
+                }
 
-                            ++j;
-                        }
+                // read instance weights of deduplicated training set, one weight per line
+                // in <training set>.weights, training set without weights file is unweighted
+                void TrainingContext::read_weights(const char *filename) {
+                    string weightsFile = string(filename) + ".weights";
+                    FILE *fp = fopen(weightsFile.c_str(), "r");
+                    if (fp == NULL)
+                        return;
+                    prob.W = Malloc(double, prob.l);
+                    int i;
+                    for (i = 0; i < prob.l; i++) {
+                        if (fscanf(fp, "%lf", &prob.W[i]) != 1)
+                            break;
+                    }
+                    double extra;
+                    if (i != prob.l || fscanf(fp, "%lf", &extra) == 1) {
+                        fprintf(stderr, "Wrong weights file %s: expected %d weights\n", weightsFile.c_str(), prob.l);
+                        exit(1);
+                    }
+                    fclose(fp);
+                }
 
-                        if (inst_max_index > max_index)
-                            max_index = inst_max_index;
-                        x_space[j++].index = -1;
+                // read in a problem (in svmlight format)
+                void TrainingContext::read_problem(const char *filename) throw (SDException&) {
+                    if (BinaryTrainingSet::isBinary(filename)) {
+                        read_binary_problem(filename);
+                        return;
                     }
+                    int max_index, i;
+                    int error_line = read_text_problem(filename, &prob, &x_space, &max_index);
+                    if (error_line != 0)
+                        exit_input_error(error_line);
 
                     if (param.gamma == 0 && max_index > 0)
                         param.gamma = 1.0 / max_index;
@@ -258,7 +360,6 @@ namespace core{
                             }
                         }
 
-                    fclose(fp);
                 }
 
             }
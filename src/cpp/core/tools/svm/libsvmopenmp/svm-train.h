@@ -3,15 +3,76 @@
 
 #include "thirdparty/lib_svm/svm.h"
 #include "typedefs.h"
+#include "core/tools/svm/BinaryTrainingSet.h"
 
 namespace core{
         namespace tools {
             namespace svm {
                 namespace libsvmopenmp {
+                    /**
+                     * state of one training run. Nothing is shared between contexts,
+                     * so separate contexts can train at the same time
+                     */
+                    class TrainingContext{
+                    private:
+                        struct svm_parameter param;
+                        struct svm_problem prob;
+                        struct svm_node *x_space;
+                        //binary training set stays mapped during training, kernel reads rows from it
+                        BinaryTrainingSet binarySet;
+                        struct svm_row_source rowSource;
+                        //number of cross validation folds, 0 trains model
+                        int nr_fold;
+
+                        void read_parameters() throw (SDException&);
+                        void read_problem(const char *filename) throw (SDException&);
+                        void read_binary_problem(const char *filename) throw (SDException&);
+                        void read_weights(const char *filename);
+                        void free_problem();
+                    protected:
+                    public:
+                        TrainingContext();
+                        virtual ~TrainingContext();
+
+                        /**
+                         * trains model from training set, or only prints cross validation
+                         * result when general.Training.svm.crossValidation is set
+                         * @param input_file_name
+                         * libsvm text or binary training set
+                         * @param model_file_name
+                         * output model
+                         * @return
+                         * 0 on success
+                         */
+                        int train(const char* input_file_name, const char* model_file_name) throw(SDException&);
+                        /**
+                         * cross validation on loaded training set, held out rows are weighted by
+                         * instance weights. Deduplicated set is split by unique color
+                         * @return
+                         * accuracy in percents for classification, mean squared error for regression
+                         */
+                        double do_cross_validation();
+                        /**
+                         * cross validated (C, gamma) grid search, configured in
+                         * general.Training.GridSearch, then trains model with best point
+                         * @param input_file_name
+                         * libsvm text or binary training set
+                         * @param model_file_name
+                         * output model of best point
+                         * @param results_file_name
+                         * output table of all grid points
+                         * @return
+                         * 0 on success
+                         */
+                        int grid_search(const char* input_file_name, const char* model_file_name,
+                                        const char* results_file_name) throw(SDException&);
+                    };
+
                     int train(char* input_file_name, char* model_file_name) throw(SDException&);
+                    int grid_search(char* input_file_name, char* model_file_name, char* results_file_name) throw(SDException&);
                 }
             }
         }
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -2,6 +2,8 @@
 
 #include "MemTracker.h"
 #include <utility>
+#include <pthread.h>
+#include "core/util/raii/RAIIS.h"
 
 namespace core{
     namespace util{
@@ -41,8 +43,11 @@ namespace core{
         }
         
         set<MemTrackerStruct> MemTracker::allocatedByManager;
+        //New and Delete are called from OpenMP threads
+        static pthread_mutex_t trackerMutex = PTHREAD_MUTEX_INITIALIZER;
         
         void MemTracker::add(MemTrackerStruct ptr) throw(SDException&){
+            raii::MutexRaii autoLock(&trackerMutex);
             pair< set<MemTrackerStruct>::iterator, bool > succ = allocatedByManager.insert(ptr);
             if (succ.second == false){
                 SDException exc(SHADOW_CANT_ADD_TO_MEM_MENAGER, "MemTracker::add");
@@ -51,6 +56,7 @@ namespace core{
         }
         
         void MemTracker::remove(void* ptr) throw(SDException&){
+            raii::MutexRaii autoLock(&trackerMutex);
             MemTrackerStruct tmp;
             tmp.ptr = ptr;
             set<MemTrackerStruct>::iterator iter = allocatedByManager.find(tmp);
@@ -68,6 +74,7 @@ namespace core{
         }
         
         string MemTracker::getUnfreed(){
+            raii::MutexRaii autoLock(&trackerMutex);
             string retString = "Unfreed:\n";
             set<MemTrackerStruct>::iterator iter = allocatedByManager.begin();
             while (iter != allocatedByManager.end()){
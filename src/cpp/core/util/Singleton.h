@@ -19,7 +19,9 @@ namespace core{
          */
         template <class T> class Singleton{
         private:
-            static T* instancePtr;            
+            static T* instancePtr;
+            //one mutex per singleton class, shared by getInstancePtr and destroy
+            static pthread_mutex_t mutex;
         protected:
             Singleton();            
             virtual ~Singleton();
@@ -36,6 +38,7 @@ namespace core{
         };
         
         template<class T> T* Singleton<T>::instancePtr = 0;
+        template<class T> pthread_mutex_t Singleton<T>::mutex = PTHREAD_MUTEX_INITIALIZER;
         
         template<class T> Singleton<T>::Singleton(){            
         }
@@ -44,7 +47,6 @@ namespace core{
         }
         
         template<class T> T* Singleton<T>::getInstancePtr(){            
-            pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
             raii::MutexRaii autoLock(&mutex);
             static T* instancePtrTmp = 0;
             if (instancePtrTmp == 0 || instancePtr == 0){
@@ -61,7 +63,6 @@ namespace core{
         }
         
         template<class T> void Singleton<T>::destroy(){           
-            pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
             raii::MutexRaii autoLock(&mutex);
             if (instancePtr != 0){
                 Delete(instancePtr);                
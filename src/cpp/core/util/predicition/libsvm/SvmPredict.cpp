@@ -31,7 +31,7 @@ namespace core{
                 }
 
                 void SvmPredict::loadModel() throw (SDException&) {
-                    string modelFile = Config::getInstancePtr()->getPropertyValue("settings.svm.modelFile");
+                    string modelFile = Config::getInstancePtr()->getPropertyValue("general.Prediction.svm.modelFile");
                     model = svm_load_model(modelFile.c_str());
                     if (model == 0) {
                         SDException e(SHADOW_READ_UNABLE, "SvmPredict::loadModel");
@@ -2,6 +2,9 @@
 #include "core/util/Config.h"
 #include "core/opencl/regression/OpenCLRegressionPredict.h"
 
+//parameter counts up to this value get predict loop with compile time known width
+#define MAX_UNROLLED_PARAMETERS 16
+
 namespace core{
     namespace util{
         namespace prediction{
@@ -14,6 +17,60 @@ namespace core{
                 using namespace core::util;
                 using namespace std;
                 
+                inline uchar logisticDecision(float result, const float& borderValue){
+                    result = -result;
+                    result = exp(result);
+                    result = 1.f + result;
+                    result = 1.f / result;
+                    if (result > borderValue)
+                        return 1U;
+                    else
+                        return 0U;
+                }
+                
+                /**
+                 * predict with row width known at compile time, so inner loop can be unrolled.
+                 * Falls back to smaller widths and finally to runtime width version
+                 */
+                template<int Width> struct FixedWidthPredict{
+                    static void predict(const float* parameters, const int& pixCount, const int& parameterCount,
+                                        const float* coefs, const float& borderValue, uchar* retArr){
+                        if (parameterCount != Width){
+                            FixedWidthPredict<Width - 1>::predict(parameters, pixCount, parameterCount, 
+                                                                    coefs, borderValue, retArr);
+                            return;
+                        }
+                        int i;
+#if defined _OPENMP_MY
+#pragma omp parallel for private(i)
+#endif
+                        for (i = 0; i < pixCount; i++){
+                            const float* row = parameters + i * Width;
+                            //intercept
+                            float result = coefs[Width];
+                            for (int j = 0; j < Width; j++){
+                                result += row[j] * coefs[j];
+                            }
+                            retArr[i] = logisticDecision(result, borderValue);
+                        }
+                    }
+                };
+                
+                template<> struct FixedWidthPredict<0>{
+                    static void predict(const float* parameters, const int& pixCount, const int& parameterCount,
+                                        const float* coefs, const float& borderValue, uchar* retArr){
+                        for (int i = 0; i < pixCount; i++){
+                            const float* row = parameters + i * parameterCount;
+                            //intercept
+                            float result = coefs[parameterCount];
+                            for (int j = 0; j < parameterCount; j++){
+                                result += row[j] * coefs[j];
+                            }
+                            retArr[i] = logisticDecision(result, borderValue);
+                        }
+                    }
+                };
+                
                 RegressionPredict::RegressionPredict(){
                     loadedModel = false;
                 }
@@ -65,22 +122,8 @@ namespace core{
                     regPredict->cleanWorkPart();
 #else
                     retArr = New uchar[pixCount];
-                    for (int i = 0; i < pixCount; i++){
-                        //intercept
-                        float result = coefs[parameterCount];
-                        for (int j = 0; j < parameterCount; j++){
-                            float a = (*imagePixelsParameters)[i][j] * coefs[j];
-                            result += a;
-                        }
-                        result = -result;
-                        result = exp(result);
-                        result = 1.f + result;
-                        result = 1.f / result;
-                        if (result > borderValue)
-                            retArr[i] = 1U;
-                        else
-                            retArr[i] = 0U;
-                    }
+                    FixedWidthPredict<MAX_UNROLLED_PARAMETERS>::predict(imagePixelsParameters->getVec(), pixCount, 
+                                                                        parameterCount, coefs.data(), borderValue, retArr);
 #endif
                     return retArr;
                 }
@@ -3,6 +3,7 @@
 #include "OpenCLImageParameters.h"
 #include "core/util/Matrix.h"
 #include "core/opencv/OpenCV2Tools.h"
+#include "shadowdetection/tools/image/ShadowFeatures.h"
 
 #ifdef _OPENCL
 
@@ -18,6 +19,10 @@ namespace shadowdetection {
             return string("shadowdetection::opencl::OpenCLImageParameters");
         }
         
+        string OpenCLImageParameters::getGeneratedSource(){
+            return shadowdetection::tools::image::ShadowFeatures::clKernel("imageShadowParameters");
+        }
+        
         OpenCLImageParameters::OpenCLImageParameters() : Singleton<OpenCLImageParameters>(){
             initVars();
         }
@@ -33,7 +33,12 @@ namespace shadowdetection {
             void setKernelArgs(const cl_uint& numOfParameters, const cl_uint& numOfPixels);
         protected:
             OpenCLImageParameters();
-            virtual std::string getClassName();            
+            virtual std::string getClassName();
+            /**
+             * @return 
+             * imageShadowParameters kernel generated from ShadowFeatures descriptors
+             */
+            virtual std::string getGeneratedSource();
         public:            
             virtual ~OpenCLImageParameters();            
             virtual void initVars();
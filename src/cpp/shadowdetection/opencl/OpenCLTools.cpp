@@ -4,6 +4,7 @@
 
 #include "core/opencv/OpenCV2Tools.h"
 #include "core/opencv/OpenCVTools.h"
+#include "core/opencv/FastHue.h"
 #include "thirdparty/lib_svm/svm.h"
 #include "core/util/Matrix.h"
 
@@ -236,6 +237,10 @@ namespace shadowdetection {
         string OpenclTools::getClassName(){
             return string("shadowdetection::opencl::OpenclTools");
         }
+        
+        string OpenclTools::getGeneratedSource(){
+            return fastHueClSource();
+        }
 
     }
 }
@@ -78,6 +78,11 @@ namespace shadowdetection {
         protected:
             OpenclTools();
             virtual std::string getClassName();
+            /**
+             * @return 
+             * fastHue function shared with CPU HSI conversion
+             */
+            virtual std::string getGeneratedSource();
         public:            
             virtual ~OpenclTools();            
             /**
@@ -33,6 +33,12 @@ float radToDegrees(float radians) {
     return radians * oneRad;
 }
 
+/**
+*hue without atan2, same as C++ fastHue. Definition is generated
+*from core/opencv/FastHue.h and appended to program source
+*/
+uint fastHue(float v1, float v2);
+
 /**
 *converts RGB pixel to HSI first way
 */
@@ -46,22 +52,11 @@ uint3 convert1(uchar r, uchar g, uchar b)
     float i = convert_float_rtz(r + g + b) / 3.f;
     
     float fS;
-    float fH;
 
     float v1 = 0.5f * (2.f * r - convert_float_rtz(g) - convert_float_rtz(b));
     float v2 = 0.5f * sqrt(3.f) * (convert_float_rtz(g) - convert_float_rtz(b));
 
-    fH = atan2(v2, v1);
-    fH = radToDegrees(fH);
-
-    if (fH < -360.f)
-        fH = -360.f;
-
-    if (fH < 0.)
-        fH += 360.f;
-
-    if (fH > 360.f)
-        fH = 360.f;    
+    uint h = fastHue(v1, v2);
     fS = 1.f - ((float)min / i);       
     if (fS > 1.f){
         fS = 1.f;
@@ -70,7 +65,7 @@ uint3 convert1(uchar r, uchar g, uchar b)
         fS = 0.f;
     }
     fS *= 255.f;    
-    retVal = (uint3)(convert_uint_rtz(fH), convert_uint_rtz(fS), convert_uint_rtz(i));
+    retVal = (uint3)(h, convert_uint_rtz(fS), convert_uint_rtz(i));
     return retVal;
 }
 
@@ -88,7 +83,6 @@ uint3 convert2(uchar r, uchar g, uchar b)
 
     delta = max - min;
     float fS;
-    float fH;
 
     float v1 = -(((sqrt(6.f) * (float)r) / 6.f) +
             ((sqrt(6.f) * (float)g) / 6.f) +
@@ -96,17 +90,7 @@ uint3 convert2(uchar r, uchar g, uchar b)
 
     float v2 = ((float)r / sqrt(6.f)) - ((2.f * (float)g) / sqrt(6.f));    
 
-    fH = atan2(v2, v1);
-    fH = radToDegrees(fH);
-
-    if (fH < -360.f)
-        fH = -360.f;
-
-    if (fH < 0.)
-        fH += 360.f;
-
-    if (fH > 360.)
-        fH = 360.f;    
+    uint h = fastHue(v1, v2);
     fS = 1.f - ((float)min / i);       
     if (fS > 1.f){
         fS = 1.f;
@@ -116,7 +100,7 @@ uint3 convert2(uchar r, uchar g, uchar b)
     }
     fS *= 255.f;
     
-    retVal = (uint3)(convert_uint_rtz(fH), convert_uint_rtz(fS), convert_uint_rtz(i));    
+    retVal = (uint3)(h, convert_uint_rtz(fS), convert_uint_rtz(i));    
     return retVal;
 }
 
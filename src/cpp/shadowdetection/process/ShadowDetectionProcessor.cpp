@@ -6,16 +6,20 @@
 #include "core/opencl/regression/OpenCLRegressionPredict.h"
 #include "core/util/Config.h"
 #include "core/opencv/OpenCV2Tools.h"
-#include "core/opencv/OpenCVTools.h"
 #if defined _OPENMP_MY
 #include <omp.h>
 #endif
 #include "shadowdetection/tools/image/ResultFixer.h"
+#include "shadowdetection/tools/image/MaskCleanup.h"
 #include "core/util/raii/RAIIS.h"
 #include "core/tools/image/IImageParameters.h"
+#include "core/tools/image/ImageView.h"
+#include "core/tools/image/BitMask.h"
+#include "core/tools/image/TsaiMask.h"
 #include "core/util/rtti/ObjectFactory.h"
 #include "core/util/predicition/IPrediction.h"
 #include "core/util/TabParser.h"
+#include "core/util/Timer.h"
 
 namespace shadowdetection {
     namespace process {
@@ -76,6 +80,265 @@ namespace shadowdetection {
 #endif
         }
 
+        bool isPropertyTrue(const string& key){
+            string value = Config::getInstancePtr()->getPropertyValue(key);
+            return value.compare("true") == 0;
+        }
+        
+        /**
+         * prints duration of processing stages when general.printStageTimes is true
+         */
+        class StageTimer{
+        private:
+            Timer timer;
+            bool enabled;
+        protected:
+        public:
+            StageTimer(){
+                enabled = isPropertyTrue("general.printStageTimes");
+            }
+            
+            void check(const char* stage){
+                int64_t duration = timer.sinceLastCheck();
+                if (enabled)
+                    cout << "Stage " << stage << ": " << duration << " ms" << endl;
+            }
+        };
+        
+        /**
+         * per image buffers reused between images processed in one run
+         */
+        struct ProcessingBuffers{
+            TsaiMask tsaiMask;
+            MaskCleanup maskCleanup;
+            BitMask processedMask;
+            Mat outputImage;
+        };
+        
+        IPrediction* getPredictor() throw (SDException&) {
+            IPrediction* predictor = ObjectFactory::getInstancePtr()->createPredictor();
+            if (predictor->hasLoadedModel() == false) {
+                predictor->loadModel();
+            }
+            return predictor;
+        }
+        
+        /**
+         * predicts shadow on whole image
+         * @param context
+         * @return 
+         * mask with bits set for predicted shadow pixels
+         */
+        BitMask* predictAll(ImageContext& context) throw (SDException&) {
+            int pixCount;
+            int parameterCount;
+            UNIQUE_PTR(IImageParameteres) ipPtr(ObjectFactory::getInstancePtr()->createImageParameters());
+            UNIQUE_PTR(Matrix<float>) parametersPtr(ipPtr->getImageParameters(context, parameterCount, pixCount));
+            if (parametersPtr.get() == 0) {
+                SDException e(SHADOW_CANT_GET_PARAMETERS, "predictAll");
+                throw e;
+            }
+            uchar* predicted = getPredictor()->predict(parametersPtr.get(), pixCount, parameterCount);
+            if (predicted == 0) {
+                SDException e(SHADOW_CANT_PREDICT, "predictAll");
+                throw e;
+            }
+            VectorRaii<uchar> vraiiPred(predicted);
+            return New BitMask(predicted, context.getHeight(), context.getWidth());
+        }
+        
+        /**
+         * predicts shadow for listed pixels and writes result in predicted mask
+         * @param context
+         * @param indices
+         * pixel indices in row major order
+         * @param predictedMask
+         * mask of context size, bits of listed pixels are set for shadow and cleared otherwise
+         */
+        void predictIndices(ImageContext& context, const vector<uint>& indices, BitMask& predictedMask) 
+                throw (SDException&) {
+            int pixCount;
+            int parameterCount;
+            UNIQUE_PTR(IImageParameteres) ipPtr(ObjectFactory::getInstancePtr()->createImageParameters());
+            UNIQUE_PTR(Matrix<float>) parametersPtr(ipPtr->getImageParameters(context, indices, parameterCount, pixCount));
+            if (parametersPtr.get() == 0) {
+                SDException e(SHADOW_CANT_GET_PARAMETERS, "predictIndices");
+                throw e;
+            }
+            uchar* predicted = getPredictor()->predict(parametersPtr.get(), pixCount, parameterCount);
+            if (predicted == 0) {
+                SDException e(SHADOW_CANT_PREDICT, "predictIndices");
+                throw e;
+            }
+            VectorRaii<uchar> vraiiPred(predicted);
+            int width = context.getWidth();
+            for (int i = 0; i < pixCount; i++){
+                int row = indices[i] / width;
+                int col = indices[i] % width;
+                if (predicted[i] != 0)
+                    predictedMask.set(row, col);
+                else
+                    predictedMask.clear(row, col);
+            }
+        }
+        
+        /**
+         * appends row major indices of set bits inside rectangle
+         * @param mask
+         * @param startRow
+         * @param endRow
+         * exclusive
+         * @param startCol
+         * @param endCol
+         * exclusive
+         * @param indices
+         */
+        void collectIndices(const BitMask& mask, int startRow, int endRow, int startCol, int endCol, 
+                            vector<uint>& indices){
+            int width = mask.getCols();
+            int startWord = startCol / BIT_MASK_WORD_BITS;
+            int endWord = (endCol - 1) / BIT_MASK_WORD_BITS;
+            for (int i = startRow; i < endRow; i++) {
+                const uint64_t* maskRow = mask.row(i);
+                for (int w = startWord; w <= endWord; w++) {
+                    uint64_t word = maskRow[w];
+                    int wordStart = w * BIT_MASK_WORD_BITS;
+                    if (wordStart < startCol)
+                        word &= ~(uint64_t)0 << (startCol - wordStart);
+                    if (endCol - wordStart < BIT_MASK_WORD_BITS)
+                        word &= ((uint64_t)1U << (endCol - wordStart)) - 1;
+                    while (word != 0) {
+                        int bit = __builtin_ctzll(word);
+                        indices.push_back(i * width + wordStart + bit);
+                        word &= word - 1;
+                    }
+                }
+            }
+        }
+        
+        /**
+         * predicts shadow only on candidate pixels, features are calculated only for them.
+         * Candidates are collected tile by tile, tiles without candidates are skipped
+         * @param context
+         * @param candidates
+         * mask of candidate pixels, returned by ResultFixer::getCandidates()
+         * @return 
+         * mask with bits set for predicted shadow pixels
+         */
+        BitMask* predictCandidates(ImageContext& context, const BitMask& candidates) throw (SDException&) {
+            int height = context.getHeight();
+            int width = context.getWidth();
+            int tileSize = atoi(Config::getInstancePtr()->getPropertyValue("general.Prediction.candidateTileSize").c_str());
+            if (tileSize <= 0)
+                tileSize = 64;
+            
+            vector<uint> indices;
+            int tileCount = 0;
+            int skippedTiles = 0;
+            for (int tileY = 0; tileY < height; tileY += tileSize) {
+                int endY = std::min(tileY + tileSize, height);
+                for (int tileX = 0; tileX < width; tileX += tileSize) {
+                    int endX = std::min(tileX + tileSize, width);
+                    size_t tileStart = indices.size();
+                    collectIndices(candidates, tileY, endY, tileX, endX, indices);
+                    tileCount++;
+                    if (indices.size() == tileStart)
+                        skippedTiles++;
+                }
+            }
+            if (isPropertyTrue("general.printStageTimes"))
+                cout << "Candidates: " << indices.size() << " of " << height * width << " pixels, skipped tiles: " 
+                        << skippedTiles << " of " << tileCount << endl;
+            
+            UNIQUE_PTR(BitMask) predictedMaskPtr(New BitMask(height, width));
+            if (indices.size() == 0) {
+                return predictedMaskPtr.release();
+            }
+            
+            predictIndices(context, indices, *predictedMaskPtr);
+            return predictedMaskPtr.release();
+        }
+        
+        /**
+         * predicts shadow on reduced image and repeats prediction in full resolution
+         * only around borders of coarse shadow regions
+         * @param context
+         * @param candidates
+         * optional mask of candidate pixels, refinement is skipped for other pixels
+         * @return 
+         * mask with bits set for predicted shadow pixels
+         */
+        BitMask* predictCoarseToFine(ImageContext& context, const BitMask* candidates) throw (SDException&) {
+            Config* conf = Config::getInstancePtr();
+            int scale = atoi(conf->getPropertyValue("general.Prediction.coarseScale").c_str());
+            int radius = atoi(conf->getPropertyValue("general.Prediction.refineRadius").c_str());
+            if (radius < 0)
+                radius = 0;
+            int height = context.getHeight();
+            int width = context.getWidth();
+            if (scale <= 1 || height < scale || width < scale) {
+                if (candidates)
+                    return predictCandidates(context, *candidates);
+                return predictAll(context);
+            }
+            
+            Mat coarseImage;
+            resize(context.getOriginal(), coarseImage, Size(width / scale, height / scale), 0, 0, INTER_AREA);
+            UNIQUE_PTR(Mat) coarsePredictedPtr;
+            {
+                ImageContext coarseContext(coarseImage);
+                UNIQUE_PTR(BitMask) coarseMaskPtr(predictAll(coarseContext));
+                //morphology and scaling are done by OpenCV on reduced image
+                coarsePredictedPtr = UNIQUE_PTR(Mat)(coarseMaskPtr->toMat());
+            }
+            
+            //coarse pixel is mixed if there are both shadow and non shadow pixels in its neighborhood
+            Mat mixed;
+            if (radius > 0) {
+                Mat element = getStructuringElement(MORPH_RECT, Size(2 * radius + 1, 2 * radius + 1));
+                Mat dilated, eroded;
+                dilate(*coarsePredictedPtr, dilated, element);
+                erode(*coarsePredictedPtr, eroded, element);
+                mixed = dilated != eroded;
+            } else {
+                mixed = Mat::zeros(coarsePredictedPtr->size(), CV_8UC1);
+            }
+            
+            Mat upscaled;
+            resize(*coarsePredictedPtr, upscaled, Size(width, height), 0, 0, INTER_NEAREST);
+            UNIQUE_PTR(BitMask) predictedMaskPtr(New BitMask(upscaled));
+            Mat refine;
+            resize(mixed, refine, Size(width, height), 0, 0, INTER_NEAREST);
+            BitMask refineMask(refine);
+            if (candidates)
+                refineMask.andWith(*candidates);
+            
+            vector<uint> indices;
+            collectIndices(refineMask, 0, height, 0, width, indices);
+            if (isPropertyTrue("general.printStageTimes"))
+                cout << "Coarse to fine: fully evaluated " << indices.size() << " of " << height * width 
+                        << " pixels (" << (100.f * indices.size()) / (height * width) << "%)" << endl;
+            if (indices.size() > 0)
+                predictIndices(context, indices, *predictedMaskPtr);
+            return predictedMaskPtr.release();
+        }
+        
+        /**
+         * predicts shadow using prediction mode selected in configuration
+         * @param context
+         * @param candidates
+         * optional mask of candidate pixels
+         * @return 
+         * mask with bits set for predicted shadow pixels
+         */
+        BitMask* predictShadows(ImageContext& context, const BitMask* candidates) throw (SDException&) {
+            if (isPropertyTrue("general.Prediction.coarseToFine"))
+                return predictCoarseToFine(context, candidates);
+            if (candidates)
+                return predictCandidates(context, *candidates);
+            return predictAll(context);
+        }
+
 #ifdef _OPENCL
 
         /**
@@ -83,150 +346,88 @@ namespace shadowdetection {
          * @param out
          * @param imageNew
          */
-        void processSingleOpenCL(const char* out, const Mat& image) {
-            UNIQUE_PTR(Mat) hlsPtr(OpenCV2Tools::convertToHLS(&image));
-            if (hlsPtr.get() == 0) {
-                return;
-            }
-            OpenclTools* oclt = OpenclTools::getInstancePtr();
-            uchar* buffer = OpenCV2Tools::convertImageToByteArray(&image, true);
-            VectorRaii<uchar> bufferRaii(buffer);
-            UNIQUE_PTR(Mat) processedImagePtr;
+        void processSingleOpenCL(const char* out, const Mat& image, ProcessingBuffers& buffers) {
             bool usePrediction = false;
             string usePredStr = Config::getInstancePtr()->getPropertyValue("general.Prediction.usePrediction");
             if (usePredStr.compare("true") == 0)
                 usePrediction = true;
-            if (usePrediction == false) {
-                try {
-                    processedImagePtr = UNIQUE_PTR(Mat)(oclt->processRGBImage(buffer, image.size().width,
-                            image.size().height, image.channels()));
-                } catch (SDException& exception) {
-                    throw exception;
-                }
-            } else {
-                UNIQUE_PTR(Mat) piPtr(oclt->processRGBImage(buffer, image.size().width, image.size().height, image.channels()));
-                if (piPtr.get()) {
-                    int pixCount;
-                    int parameterCount;
-                    UNIQUE_PTR(IImageParameteres) ipPtr(ObjectFactory::getInstancePtr()->createImageParameters());
-
-                    UNIQUE_PTR(Mat) hsvPtr(OpenCV2Tools::convertToHSV(&image));
-                    if (hsvPtr.get() == 0) {
-                        return;
-                    }
-                    
-                    vector<const Mat*> images;
-                    images.push_back(&image);
-                    images.push_back(hsvPtr.get()); 
-                    images.push_back(hlsPtr.get());
-                    UNIQUE_PTR(Matrix<float>) parametersPtr(ipPtr->getImageParameters(images,
-                            parameterCount, pixCount));
-                    if (parametersPtr.get() != 0) {
-                        IPrediction* predictor = ObjectFactory::getInstancePtr()->createPredictor();
-                        if (predictor->hasLoadedModel() == false) {
-                            predictor->loadModel();
-                        }
-                        uchar* predicted = predictor->predict(parametersPtr.get(), pixCount, parameterCount);
-                        if (predicted) {
-                            VectorRaii<uchar> vraiiPred(predicted);
-                            //FileSaver<uchar>::saveToFile("myPredictedOCL.out", predicted, pixCount);
-                            for (int i = 0; i < pixCount; i++)
-                                predicted[i] *= 255;
-                            UNIQUE_PTR(Mat) predictedImagePtr(OpenCV2Tools::get8bitImage(predicted,
-                                    image.size().height, image.size().width));
-                            processedImagePtr = UNIQUE_PTR(Mat)(OpenCV2Tools::joinTwoOcl(*piPtr, *predictedImagePtr));
-                        } else {
-                            SDException e(SHADOW_CANT_PREDICT, "processSingleOpenCL");
-                            throw e;
-                        }
-                    } else {
-                        SDException e(SHADOW_CANT_GET_PARAMETERS, "processSingleOpenCL");
-                        throw e;
-                    }
-                }
+            StageTimer stageTimer;
+            ImageContext context(image);
+            ResultFixer rf;
+            UNIQUE_PTR(BitMask) candidatesPtr;
+            if (usePrediction && isPropertyTrue("general.Prediction.candidateFirst")){
+                candidatesPtr = UNIQUE_PTR(BitMask)(rf.getCandidates(context));
+                stageTimer.check("candidates");
+            }
+            OpenclTools* oclt = OpenclTools::getInstancePtr();
+            uchar* buffer = OpenCV2Tools::convertImageToByteArray(&image, true);
+            VectorRaii<uchar> bufferRaii(buffer);
+            UNIQUE_PTR(Mat) piPtr(oclt->processRGBImage(buffer, image.size().width, image.size().height, image.channels()));
+            stageTimer.check("tsai");
+            if (piPtr.get() == 0)
+                return;
+            //device result is packed once, masks stay packed until image is written
+            BitMask processedMask(*piPtr);
+            if (usePrediction) {
+                UNIQUE_PTR(BitMask) predictedMaskPtr(predictShadows(context, candidatesPtr.get()));
+                stageTimer.check("prediction");
+                processedMask.orWith(*predictedMaskPtr);
             }
-            if (processedImagePtr.get() != 0) {
-                ResultFixer rf;
-                rf.applyThreshholds(*processedImagePtr, image, *hlsPtr);
-                imwrite(out, *processedImagePtr);
+            if (candidatesPtr.get() != 0)
+                rf.applyCandidates(processedMask, *candidatesPtr);
+            else
+                rf.applyThreshholds(processedMask, context);
+            stageTimer.check("result fix");
+            if (buffers.maskCleanup.isEnabled()){
+                buffers.maskCleanup.apply(processedMask);
+                stageTimer.check("cleanup");
             }
+            processedMask.toMat(buffers.outputImage);
+            imwrite(out, buffers.outputImage);
         }
 #else
         /**
         * process single image on CPU not using openCL
         * @param out
         * @param image
+        * BGR image
+        * @param buffers
         */
-       void processSingleCPU(const char* out, IplImage* image) {    
-           Mat imageMat(image);
-           UNIQUE_PTR(Mat) hls(OpenCV2Tools::convertToHLS(&imageMat));
-           if (hls == 0){
-               return;
-           }    
-
-           IplImage* processedImage = 0;
-           int height, width, channels;
-           uint* hsi1 = OpenCvTools::convertImagetoHSI(image, height, width, channels, &OpenCvTools::RGBtoHSI_1);
-           VectorRaii<uint> vraiiHsi1(hsi1);
-           uchar* ratios1 = OpenCvTools::simpleTsai(hsi1, height, width, channels);
-           VectorRaii<uchar> vraiiR1(ratios1);
-           IplImage* ratiosImage1 = OpenCvTools::get8bitImage(ratios1, height, width);
-           ImageRaii iariiR1(ratiosImage1);
-           IplImage* binarized1 = OpenCvTools::binarize(ratiosImage1);
-           ImageRaii iraiiBin1(binarized1);
-           uint* hsi2 = OpenCvTools::convertImagetoHSI(image, height, width, channels, &OpenCvTools::RGBtoHSI_2);
-           VectorRaii<uint> vraiiHsi2(hsi2);
-           uchar* ratios2 = OpenCvTools::simpleTsai(hsi2, height, width, channels);
-           VectorRaii<uchar> vraiiR2(ratios2);
-           IplImage* ratiosImage2 = OpenCvTools::get8bitImage(ratios2, height, width);
-           ImageRaii iraiiR2(ratiosImage2);
-           IplImage* binarized2 = OpenCvTools::binarize(ratiosImage2);
-           ImageRaii iraiiBin2(binarized2);
-
+       void processSingleCPU(const char* out, const Mat& image, ProcessingBuffers& buffers) {
            bool usePrediction = false;
            string usePredStr = Config::getInstancePtr()->getPropertyValue("general.Prediction.usePrediction");
            if (usePredStr.compare("true") == 0)
                usePrediction = true;
-           if (usePrediction){
-               IplImage* pi = OpenCvTools::joinTwo(binarized1, binarized2);
-               ImageRaii iraii(pi);        
-               int pixCount;
-               int parameterCount;
+           StageTimer stageTimer;
+           ImageContext context(image);
 
-               UNIQUE_PTR(Mat) hsv(OpenCV2Tools::convertToHSV(&imageMat));
-               if (hsv == 0){
-                   return;
-               }        
+           //both HSI variants, Tsai ratios, Otsu and OR in one fused pass
+           BitMask& processedMask = buffers.processedMask;
+           buffers.tsaiMask.detect(image, processedMask);
+           stageTimer.check("tsai");
 
-               UNIQUE_PTR(IImageParameteres) ipPtr(ObjectFactory::getInstancePtr()->createImageParameters());        
-               
-               vector<const Mat*> images;
-               images.push_back(&imageMat); images.push_back(hsv.get()); images.push_back(hls.get());
-               
-               UNIQUE_PTR(Matrix<float>) parameters(ipPtr->getImageParameters(  images, 
-                                                                                parameterCount, pixCount));
-               IPrediction* predictor = ObjectFactory::getInstancePtr()->createPredictor();
-               if (predictor->hasLoadedModel() == false){            
-                   predictor->loadModel();
+           ResultFixer rf;
+           UNIQUE_PTR(BitMask) candidatesPtr;
+           if (usePrediction){
+               if (isPropertyTrue("general.Prediction.candidateFirst")){
+                   candidatesPtr = UNIQUE_PTR(BitMask)(rf.getCandidates(context));
+                   stageTimer.check("candidates");
                }
-               uchar* predicted = predictor->predict(parameters.get(), pixCount, parameterCount);
-               VectorRaii<uchar> vraii(predicted);        
-               for (int i = 0; i < pixCount; i++)
-                   predicted[i] *= 255;
-               IplImage* predictedImage = OpenCvTools::get8bitImage(predicted, height, width);
-               ImageRaii iraii2(predictedImage);        
-               processedImage = OpenCvTools::joinTwo(pi, predictedImage);               
+               UNIQUE_PTR(BitMask) predictedMaskPtr(predictShadows(context, candidatesPtr.get()));
+               stageTimer.check("prediction");
+               processedMask.orWith(*predictedMaskPtr);
            }
-           else{
-               processedImage = OpenCvTools::joinTwo(binarized1, binarized2);
-           }
-           if (processedImage){
-               ImageRaii iraii(processedImage);
-               ResultFixer rf;
-               Mat processedImageMat(processedImage);
-               rf.applyThreshholds(processedImageMat, imageMat, *hls);
-               cvSaveImage(out, processedImage);
+           if (candidatesPtr.get() != 0)
+               rf.applyCandidates(processedMask, *candidatesPtr);
+           else
+               rf.applyThreshholds(processedMask, context);
+           stageTimer.check("result fix");
+           if (buffers.maskCleanup.isEnabled()){
+               buffers.maskCleanup.apply(processedMask);
+               stageTimer.check("cleanup");
            }
+           processedMask.toMat(buffers.outputImage);
+           imwrite(out, buffers.outputImage);
         }
 #endif
 
@@ -248,34 +449,21 @@ namespace shadowdetection {
 #endif
         }
        
-        void processSingle(const char* input, const char* out) throw (SDException&) {
+        void processSingle(const char* input, const char* out, ProcessingBuffers& buffers) throw (SDException&) {
             cout << "===========" << endl;
             cout << "Processing: " << input << endl;
-            try {
+            Mat image = cv::imread(input);
+            if (image.data == 0) {
+                string msg = "Process single image file: ";
+                msg += input;
+                SDException exc(SHADOW_READ_UNABLE, msg);
+                throw exc;
+            }
 #ifdef _OPENCL
-                Mat imageNew = cv::imread(input);
-                if (imageNew.data == 0) {
-                    string msg = "Process single image file: ";
-                    msg += input;
-                    SDException exc(SHADOW_READ_UNABLE, msg);
-                    throw exc;
-                }
-                processSingleOpenCL(out, imageNew);
+            processSingleOpenCL(out, image, buffers);
 #else
-                IplImage* image = cvLoadImage(input);
-                if (image != 0) {
-                    ImageRaii rai(image);
-                    processSingleCPU(out, image);
-                } else {
-                    string msg = "Process single image file: ";
-                    msg += input;
-                    SDException exc(SHADOW_READ_UNABLE, msg);
-                    throw exc;
-                }
+            processSingleCPU(out, image, buffers);
 #endif
-            } catch (SDException& exception) {
-                throw exception;
-            }
         }
 
         ShadowDetectionProcessor::ShadowDetectionProcessor() : IProcessor() {
@@ -299,7 +487,8 @@ namespace shadowdetection {
                     char* path = argv[1];
                     char* savePath = argv[2];
                     try {
-                        processSingle(path, savePath);
+                        ProcessingBuffers buffers;
+                        processSingle(path, savePath, buffers);
                     } catch (SDException& exception) {
                         cout << exception.handleException() << endl;                        
                         return;
@@ -318,11 +507,13 @@ namespace shadowdetection {
                         cout << exception.handleException() << endl;
                         exit(1);
                     }
+                    //buffers are shared by all images, so same sized images don't allocate them again
+                    ProcessingBuffers buffers;
                     for (uint i = 0; i < tp.size(); i++) {
                         string in = tp.get(i).getFirst();
                         string out = tp.get(i).getSecond();
                         try {
-                            processSingle(in.c_str(), out.c_str());
+                            processSingle(in.c_str(), out.c_str(), buffers);
                         } catch (SDException& exception) {
                             cout << exception.handleException() << endl;
                             cout << "Continue to process" << endl;
@@ -4,14 +4,12 @@
 #include "core/util/MemTracker.h"
 #include "core/util/raii/RAIIS.h"
 #include "core/util/Config.h"
+#include "ShadowFeatures.h"
+#include "core/tools/image/ImageView.h"
 #ifdef _OPENCL
 #include "shadowdetection/opencl/OpenCLImageParameters.h"
 #endif
 
-#define SPACES_COUNT 3
-#define HSV_PARAMETERS 5
-#define HLS_PARAMETERS 5
-#define BGR_PARAMETERS 2
 #define ROI_PARAMETERS 1;
 
 namespace shadowdetection{
@@ -22,6 +20,7 @@ namespace shadowdetection{
             using namespace core::opencv2;
             using namespace core::util;
             using namespace core::util::raii;
+            using namespace core::tools::image;
 #ifdef _OPENCL
             using namespace shadowdetection::opencl;
 #endif            
@@ -83,11 +82,11 @@ namespace shadowdetection{
                     return 1.f;
             }
             
-            Matrix<float>* ImageShadowParameters::getImageParameters(   const std::vector<const Mat*>& images,
+            Matrix<float>* ImageShadowParameters::getImageParameters(   ImageContext& context,
                                                                         const Mat& maskImage,
                                                                         int& rowDimension, 
                                                                         int& pixelNum) throw (SDException&){
-                const Mat& originalImage = *(images[0]); 
+                const Mat& originalImage = context.getOriginal();
                 if (originalImage.data == 0 || maskImage.data == 0)
                     return 0;
                 if (originalImage.size().width != maskImage.size().width ||
@@ -96,57 +95,31 @@ namespace shadowdetection{
                     throw exc;    
                 }
                 UNIQUE_PTR(Matrix<float>) retPtr;                
-                int maskChan = maskImage.channels();
-                if (maskChan > 1){
-                    SDException exc(SHADOW_INVALID_IMAGE_FORMAT, "ImageParameters::getImageParameters, MaskImage");
-                    throw exc;
-                }
+                ConstMaskView maskView(maskImage);
                 int height = originalImage.size().height;
                 int width = originalImage.size().width;
                 int noLabelDataRowDimension;
                 int pixelCount;
                 
-                UNIQUE_PTR(Mat) hsvPtr(OpenCV2Tools::convertToHSV(&originalImage));
-                if (hsvPtr.get() == 0){
-                    return 0;
-                }                
-                
-                UNIQUE_PTR(Mat) hlsPtr(OpenCV2Tools::convertToHLS(&originalImage));
-                if (hlsPtr.get() == 0){
-                    return 0;
-                }                
-                
-                vector<const Mat*> images1;
-                images1.push_back(&originalImage); images1.push_back(hsvPtr.get()); images1.push_back(hlsPtr.get());
-                UNIQUE_PTR(const Matrix<float>) noLabelPtr(getImageParameters(  images1,
+                UNIQUE_PTR(const Matrix<float>) noLabelPtr(getImageParameters(  context,
                                                                                 noLabelDataRowDimension, pixelCount));
-                if (noLabelPtr.get() != 0){                    
+                if (noLabelPtr.get() != 0){
+                    int mergedSize = noLabelDataRowDimension + 1;
+                    retPtr = UNIQUE_PTR(Matrix<float>)(New Matrix<float>(mergedSize, width * height));
+                    const float* noLabelData = noLabelPtr->getVec();
+                    float* retData = retPtr->getVec();
                     for (int i = 0; i < height; i++) {
+                        const uchar* maskRow = maskView.row(i);
                         for (int j = 0; j < width; j++) {
-                            float label = OpenCV2Tools::getChannelValue(maskImage, j, i, 0); //getLabel(maskImage.data[i * maskStep + j * maskChan]);
-                            label /= 255.f;
-                            
-                            int sizes[1];
-                            sizes[0] = noLabelDataRowDimension;
-                            const float* procs[1];
-                            procs[0] = (*noLabelPtr)[i * width + j];
-                            int mergedSize;
-                            float* merged = merge(label, procs, 1, sizes, mergedSize);
-                            if (merged == 0){                                
-                                return 0;
-                            }
-                            VectorRaii<float> vraii(merged);
-                            if (retPtr.get() == 0){
-                                retPtr = UNIQUE_PTR(Matrix<float>)(New Matrix<float>(mergedSize, width * height));                                
-                            }
-                            
-                            (*retPtr)[i * width + j] = merged;                                                    
-                            if (i == 0 && j == 0){
-                                rowDimension = mergedSize;
-                                pixelNum = width * height;
-                            }
+                            int index = i * width + j;
+                            float* row = retData + index * mergedSize;
+                            row[0] = (float)maskRow[j] / 255.f;
+                            memcpy(row + 1, noLabelData + index * noLabelDataRowDimension, 
+                                    noLabelDataRowDimension * sizeof(float));
                         }
-                    }                    
+                    }
+                    rowDimension = mergedSize;
+                    pixelNum = width * height;
                 }
                 else{
                     return 0;
@@ -155,147 +128,98 @@ namespace shadowdetection{
                 return ret;
             }
             
-            Matrix<float>* ImageShadowParameters::getImageParameters( const std::vector<const cv::Mat*>& images,
+            Matrix<float>* ImageShadowParameters::getImageParameters( ImageContext& context,
                                                                 int& rowDimension,
                                                                 int& pixelNum) throw (SDException&){
-                const Mat& originalImage = *images[0];
-                const Mat& hsvImage = *images[1];
-                const Mat& hlsImage = *images[2];
+                const Mat& originalImage = context.getOriginal();
+                const Mat& hsvImage = context.getHSV();
+                const Mat& hlsImage = context.getHLS();
                 if (originalImage.data == 0 || hsvImage.data == 0 || hlsImage.data == 0)
                     return 0;
                 int height = originalImage.size().height;
                 int width = originalImage.size().width;                
 #ifdef _OPENCL
                 pixelNum = width * height;
-                uint parameterCount = HSV_PARAMETERS + HLS_PARAMETERS + BGR_PARAMETERS;
+                uint parameterCount = ShadowFeatures::width;
                 Matrix<float>* ret = OpenCLImageParameters::getInstancePtr()->getImageParameters(&originalImage, 
                                                                             &hsvImage, &hlsImage, parameterCount);
                 OpenCLImageParameters::getInstancePtr()->cleanWorkPart();
                 rowDimension = parameterCount;
                 return ret;
 #else
-                UNIQUE_PTR(Matrix<float>) ret;                
-                
-                for (int i = 0; i < height; i++) {
+                const uint parameterCount = ShadowFeatures::width;
+                ConstColorView views[FEATURE_SOURCE_COUNT] = {  ConstColorView(originalImage), 
+                                                                ConstColorView(hsvImage), 
+                                                                ConstColorView(hlsImage)};
+                UNIQUE_PTR(Matrix<float>) ret(New Matrix<float>(parameterCount, width * height));
+                float* retData = ret->getVec();
+                int i;
+#if defined _OPENMP_MY
+#pragma omp parallel for private(i)
+#endif
+                for (i = 0; i < height; i++) {
+                    const uchar* pixels[FEATURE_SOURCE_COUNT];
+                    for (int k = 0; k < FEATURE_SOURCE_COUNT; k++){
+                        pixels[k] = views[k].row(i);
+                    }
+                    float* row = retData + i * width * parameterCount;
                     for (int j = 0; j < width; j++) {
-                        Pair<uint> location((uint)j, (uint)i);
-                        uchar hHSV = OpenCV2Tools::getChannelValue(hsvImage, location, 0);
-                        uchar sHSV = OpenCV2Tools::getChannelValue(hsvImage, location, 1);
-                        uchar vHSV = OpenCV2Tools::getChannelValue(hsvImage, location, 2);
-
-                        uchar hHLS = OpenCV2Tools::getChannelValue(hlsImage, location, 0);
-                        uchar lHLS = OpenCV2Tools::getChannelValue(hlsImage, location, 1);
-                        uchar sHLS = OpenCV2Tools::getChannelValue(hlsImage, location, 2);
-
-                        float* procs[SPACES_COUNT];
-                        int size[SPACES_COUNT];
-                        procs[0] = processHSV(hHSV, sHSV, vHSV, size[0]);
-                        if (procs[0] == 0){
-                            return 0;
-                        }
-                        VectorRaii<float> vraiiProc0(procs[0]);
-                        procs[1] = processHLS(hHLS, lHLS, sHLS, size[1]);
-                        if (procs[1] == 0){
-                            return 0;
-                        }
-                        VectorRaii<float> vraiiProc1(procs[1]);
-                        uchar B = OpenCV2Tools::getChannelValue(originalImage, location, 0);
-                        uchar G = OpenCV2Tools::getChannelValue(originalImage, location, 1);
-                        uchar R = OpenCV2Tools::getChannelValue(originalImage, location, 2);
-                        procs[2] = processBGR(B, G, R, size[2]);
-                        if (procs[2] == 0){
-                            return 0;
-                        }
-                        VectorRaii<float> vraiiProc2(procs[2]);                                                
-                        
-                        int mergedSize = 0;
-                        float* merged = ImageShadowParameters::merge(procs, SPACES_COUNT, size, mergedSize);
-                        if (merged == 0){                            
-                            return 0;
-                        }
-                        VectorRaii<float> vraii(merged);
-                        if (ret == 0){
-                            ret = UNIQUE_PTR(Matrix<float>)(New Matrix<float>(mergedSize, width * height));                            
-                        }
-                                                
-                        (*ret)[i * width + j] = merged;                        
-                        if (i == 0 && j == 0) {
-                            rowDimension = mergedSize;
-                            pixelNum = width * height;
+                        ShadowFeatures::extract(pixels, row);
+                        row += parameterCount;
+                        for (int k = 0; k < FEATURE_SOURCE_COUNT; k++){
+                            pixels[k] += 3;
                         }
                     }
                 }
+                rowDimension = parameterCount;
+                pixelNum = width * height;
                 Matrix<float>* retPtr = ret.release();
                 return retPtr;
 #endif
             }
             
-            float* ImageShadowParameters::processHSV(uchar H, uchar S, uchar V, int& size) {
-                size = HSV_PARAMETERS;
-                float* retArr = New float[size];
-                if (retArr != 0){
-                //180 is max in opencv for H
-//                    retArr[0] = (float) H / 180.f;
-//                    retArr[0] = clamp(retArr[0], 0.f, 1.f);
-                    retArr[0] = (float) S / 255.f;
-                    retArr[0] = clamp<float>(retArr[0], 0.f, 1.f);
-                    retArr[1] = (float) V / 255.f;
-                    retArr[1] = clamp<float>(retArr[1], 0.f, 1.f);
-                    retArr[2] = (float) H / (float) (S + 1);
-                    retArr[2] /= 180.f;
-                    retArr[2] = clamp<float>(retArr[2], 0.f, 1.f);
-                    retArr[3] = (float) H / (float) (V + 1);
-                    retArr[3] /= 180.f;
-                    retArr[3] = clamp<float>(retArr[3], 0.f, 1.f);
-                    retArr[4] = (float) S / (float) (V + 1);
-                    retArr[4] /= 255.f;
-                    retArr[4] = clamp<float>(retArr[4], 0.f, 1.f);
-                }
-                return retArr;
-            }
-
-            float* ImageShadowParameters::processHLS(uchar H, uchar L, uchar S, int& size) {
-                size = HLS_PARAMETERS;
-                float* retArr = New float[size];
-                if (retArr != 0){
-                //180 is max in opencv for H
-//                    retArr[0] = (float) H / 180.f;
-//                    retArr[0] = clamp(retArr[0], 0.f, 1.f);
-                    retArr[0] = (float) L / 255.f;
-                    retArr[0] = clamp<float>(retArr[0], 0.f, 1.f);
-                    retArr[1] = (float) S / 255.f;
-                    retArr[1] = clamp<float>(retArr[1], 0.f, 1.f);
-                    retArr[2] = (float) H / (float) (L + 1);
-                    retArr[2] /= 180.f;
-                    retArr[2] = clamp<float>(retArr[2], 0.f, 1.f);
-                    retArr[3] = (float) H / (float) (S + 1);
-                    retArr[3] /= 180.f;
-                    retArr[3] = clamp<float>(retArr[3], 0.f, 1.f);
-                    retArr[4] = (float) L / (float) (S + 1);
-                    retArr[4] /= 255.f;
-                    retArr[4] = clamp<float>(retArr[4], 0.f, 1.f);
+            Matrix<float>* ImageShadowParameters::getImageParameters( ImageContext& context,
+                                                                const std::vector<uint>& pixelIndices,
+                                                                int& rowDimension,
+                                                                int& pixelNum) throw (SDException&){
+                const Mat& originalImage = context.getOriginal();
+                const Mat& hsvImage = context.getHSV();
+                const Mat& hlsImage = context.getHLS();
+                ConstColorView views[FEATURE_SOURCE_COUNT] = {  ConstColorView(originalImage), 
+                                                                ConstColorView(hsvImage), 
+                                                                ConstColorView(hlsImage)};
+                uint width = originalImage.cols;
+                uint numOfPixels = width * originalImage.rows;
+                const uint parameterCount = ShadowFeatures::width;
+                int count = (int)pixelIndices.size();
+                UNIQUE_PTR(Matrix<float>) ret(New Matrix<float>(parameterCount, count));
+                float* retData = ret->getVec();
+                bool outOfBounds = false;
+                int i;
+#if defined _OPENMP_MY
+#pragma omp parallel for private(i)
+#endif
+                for (i = 0; i < count; i++){
+                    uint index = pixelIndices[i];
+                    if (index >= numOfPixels){
+                        outOfBounds = true;
+                        continue;
+                    }
+                    uint y = index / width;
+                    uint x = index % width;
+                    const uchar* pixels[FEATURE_SOURCE_COUNT];
+                    for (int k = 0; k < FEATURE_SOURCE_COUNT; k++){
+                        pixels[k] = views[k].pixel(y, x);
+                    }
+                    ShadowFeatures::extract(pixels, retData + i * parameterCount);
                 }
-                return retArr;                
-            }
-            
-            float* ImageShadowParameters::processBGR(uchar B, uchar G, uchar R, int& size){
-                size = BGR_PARAMETERS;
-                float* retArr = New float[size];
-                if (retArr != 0){
-                    retArr[0] = (float)B / 255.f;
-                    retArr[0] = clamp<float>(retArr[0], 0.f, 1.f);
-                    retArr[1] = (float)(G + R) / (255.f + 255.f);
-                    retArr[1] = clamp<float>(retArr[1], 0.f, 1.f);
-                    //normalized bgr values
-//                    float bgrSum = (float)((int)B + (int)G + (int)R + 1);
-//                    retArr[2] = (float)B / bgrSum;
-//                    retArr[2] = clamp<float>(retArr[2], 0.f, 1.f);
-//                    retArr[3] = (float)G / bgrSum;
-//                    retArr[3] = clamp<float>(retArr[3], 0.f, 1.f);
-//                    retArr[4] = (float)R / bgrSum;
-//                    retArr[4] = clamp<float>(retArr[4], 0.f, 1.f);
+                if (outOfBounds){
+                    SDException exc(SHADOW_OUT_OF_BOUNDS, "ImageShadowParameters::getImageParameters, pixelIndices");
+                    throw exc;
                 }
-                return retArr;
+                rowDimension = parameterCount;
+                pixelNum = count;
+                return ret.release();
             }
             
             Matrix<float>* ImageShadowParameters::getAvgChannelValForRegions(const Mat* originalImage, uchar channelIndex){                                                
@@ -332,7 +256,13 @@ namespace shadowdetection{
                     getAvgChannelValForRegions(originalImage, channelIndex);
                 }
                 
-                float value = (float)OpenCV2Tools::getChannelValue(*originalImage, location, channelIndex);
+                ConstColorView originalView(*originalImage);
+                if (location.getFirst() >= (uint)originalView.getCols() || location.getSecond() >= (uint)originalView.getRows() ||
+                    channelIndex >= ConstColorView::channels){
+                    SDException exc(SHADOW_OUT_OF_BOUNDS, "ImageParameters::processROI");
+                    throw exc;
+                }
+                float value = (float)originalView.pixel(location.getSecond(), location.getFirst())[channelIndex];
                 
                 int yAvgIndex = location.getSecond() / segmentHeight;
                 int xAvgIndex = location.getFirst() / segmentWidth;                
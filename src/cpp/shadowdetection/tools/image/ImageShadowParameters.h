@@ -19,9 +19,6 @@ namespace shadowdetection{
                 float segmentWidth;
                 float segmentHeight;
                 
-                static float* processHSV(   uchar H, uchar S, uchar V, int& size);
-                static float* processHLS(   uchar H, uchar L, uchar S, int& size);
-                static float* processBGR(   uchar B, uchar G, uchar R, int& size);
                 float* processROI(  Pair<uint> location, const cv::Mat* originalImage, 
                                     int& size, uchar channelIndex) throw (SDException&);
                 core::util::Matrix<float>* getAvgChannelValForRegions(const cv::Mat* originalImage,
@@ -33,11 +30,14 @@ namespace shadowdetection{
                 ImageShadowParameters();
                 virtual ~ImageShadowParameters();
                                 
-                virtual core::util::Matrix<float>* getImageParameters(  const std::vector<const cv::Mat*>& images,
+                virtual core::util::Matrix<float>* getImageParameters(  core::tools::image::ImageContext& context,
                                                                         int& rowDimension, int& pixelNum) throw (SDException&);
-                virtual core::util::Matrix<float>* getImageParameters(  const std::vector<const cv::Mat*>& images,
+                virtual core::util::Matrix<float>* getImageParameters(  core::tools::image::ImageContext& context,
                                                                         const cv::Mat& maskImage,
                                                                         int& rowDimension, int& pixelNum) throw (SDException&);
+                virtual core::util::Matrix<float>* getImageParameters(  core::tools::image::ImageContext& context,
+                                                                        const std::vector<uint>& pixelIndices,
+                                                                        int& rowDimension, int& pixelNum) throw (SDException&);
                 virtual void reset();
             };
             
@@ -0,0 +1,79 @@
+#include "MaskCleanup.h"
+#include "core/util/Config.h"
+#include "core/tools/image/ImageView.h"
+#include <vector>
+#if defined _OPENMP_MY
+#include <omp.h>
+#endif
+
+namespace shadowdetection{
+    namespace tools{
+        namespace image{
+
+            using namespace cv;
+            using namespace std;
+            using namespace core::util;
+            using namespace core::tools::image;
+
+            MaskCleanup::MaskCleanup(){
+                init();
+            }
+
+            MaskCleanup::~MaskCleanup(){
+            }
+
+            void MaskCleanup::init() throw(SDException&){
+                Config* conf = Config::getInstancePtr();
+                string useCleanupStr = conf->getPropertyValue("shadowDetection.Cleanup.useCleanup");
+                useCleanup = useCleanupStr.compare("true") == 0;
+                string openSizeStr = conf->getPropertyValue("shadowDetection.Cleanup.openSize");
+                openSize = atoi(openSizeStr.c_str());
+                string closeSizeStr = conf->getPropertyValue("shadowDetection.Cleanup.closeSize");
+                closeSize = atoi(closeSizeStr.c_str());
+                string minAreaStr = conf->getPropertyValue("shadowDetection.Cleanup.minArea");
+                minArea = (uint)atoi(minAreaStr.c_str());
+            }
+
+            bool MaskCleanup::isEnabled() const{
+                return useCleanup;
+            }
+
+            void MaskCleanup::removeSmallRegions() throw(SDException&){
+                components.label(workImage, 255);
+                uint regionCount = components.getRegionCount();
+                //label 0 is background and stays cleared
+                vector<uchar> keep(regionCount + 1, 0);
+                for (uint k = 1; k <= regionCount; k++){
+                    keep[k] = (components.getRegion(k).area >= minArea) ? 255 : 0;
+                }
+                ConstLabelView labelsView(components.getLabels());
+                MaskView workView(workImage);
+                int i;
+#if defined _OPENMP_MY
+                #pragma omp parallel for private(i)
+#endif
+                for (i = 0; i < workView.getRows(); i++){
+                    const int* labelsRow = labelsView.row(i);
+                    uchar* workRow = workView.row(i);
+                    for (int j = 0; j < workView.getCols(); j++){
+                        workRow[j] = keep[labelsRow[j]];
+                    }
+                }
+            }
+
+            void MaskCleanup::apply(BitMask& mask) throw(SDException&){
+                if (useCleanup == false)
+                    return;
+                mask.toMat(workImage);
+                if (openSize > 1)
+                    morphology.open(workImage, workImage, openSize, openSize);
+                if (closeSize > 1)
+                    morphology.close(workImage, workImage, closeSize, closeSize);
+                if (minArea > 1)
+                    removeSmallRegions();
+                mask.fromMat(workImage);
+            }
+
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef __MASK_CLEANUP_H__
+#define __MASK_CLEANUP_H__
+
+#include "typedefs.h"
+#include "opencv2/core/core.hpp"
+#include "core/tools/image/BitMask.h"
+#include "core/tools/image/ConnectedComponents.h"
+#include "core/tools/image/Morphology.h"
+
+namespace shadowdetection{
+    namespace tools{
+        namespace image{
+
+            /**
+             * optional post processing of shadow mask, applied after ResultFixer.
+             * Opening removes isolated shadow pixels, closing fills small gaps in shadows
+             * and shadow regions smaller than minimum area are removed.
+             * Configured in shadowDetection.Cleanup
+             */
+            class MaskCleanup{
+            private:
+                bool useCleanup;
+                int openSize;
+                int closeSize;
+                uint minArea;
+                //kept between images to avoid reallocation
+                cv::Mat workImage;
+                core::tools::image::Morphology morphology;
+                core::tools::image::ConnectedComponents components;
+
+                void init() throw(SDException&);
+                void removeSmallRegions() throw(SDException&);
+            protected:
+            public:
+                MaskCleanup();
+                virtual ~MaskCleanup();
+
+                /**
+                 * @return
+                 * true if clean up is turned on in configuration
+                 */
+                bool isEnabled() const;
+                /**
+                 * @param mask
+                 * shadow mask, changed in place
+                 */
+                void apply(core::tools::image::BitMask& mask) throw(SDException&);
+            };
+
+        }
+    }
+}
+
+#endif
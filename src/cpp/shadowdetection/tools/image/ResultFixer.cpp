@@ -3,6 +3,11 @@
 #include "core/opencv/OpenCV2Tools.h"
 #include "core/util/Config.h"
 #include "skydetection/SkyDetection.h"
+#include "core/tools/image/ImageView.h"
+#include <algorithm>
+#if defined _OPENMP_MY
+#include <omp.h>
+#endif
 
 namespace shadowdetection{
     namespace tools{
@@ -13,6 +18,7 @@ namespace shadowdetection{
             using namespace core::util;
             using namespace skydetection;
             using namespace std;
+            using namespace core::tools::image;
         
             ResultFixer::ResultFixer(){
                 init();
@@ -36,50 +42,57 @@ namespace shadowdetection{
                     useSky = false;
             }
             
-            void ResultFixer::applyThreshholds( Mat& image, const Mat& originalImage, 
-                                                const Mat& hlsImage) throw(SDException&){
-                if (image.channels() > 1){
-                    SDException exc(SHADOW_INVALID_IMAGE_FORMAT, "ResultFixer::applyThreshholds chn");
-                    throw exc;
+            /**
+             * packs lightness test of one HLS row, bit is set for pixels darker than threshold
+             */
+            inline void packDarkPixels(const uchar* hlsRow, uint64_t* dst, int cols, uchar lThreshold){
+                for (int w = 0; w * BIT_MASK_WORD_BITS < cols; w++){
+                    int count = min(BIT_MASK_WORD_BITS, cols - w * BIT_MASK_WORD_BITS);
+                    const uchar* pixel = hlsRow + w * BIT_MASK_WORD_BITS * 3;
+                    uint64_t word = 0;
+                    for (int k = 0; k < count; k++){
+                        word |= (uint64_t)(pixel[k * 3 + 1] < lThreshold) << k;
+                    }
+                    dst[w] = word;
                 }
-                if (originalImage.channels() < 3 || hlsImage.channels() < 3){
-                    SDException exc(SHADOW_INVALID_IMAGE_FORMAT, "ResultFixer::applyThreshholds or chn");
-                    throw exc;
+            }
+            
+            void ResultFixer::applyThreshholds(BitMask& image, ImageContext& context) throw(SDException&){
+                if (useThresh || useSky){
+                    UNIQUE_PTR(BitMask) candidatesPtr(getCandidates(context));
+                    applyCandidates(image, *candidatesPtr);
                 }
-                
-                if (image.size != originalImage.size || image.size != hlsImage.size){
-                    SDException exc(SHADOW_INVALID_IMAGE_FORMAT, "ResultFixer::applyThreshholds sizes");
-                    throw exc;
+            }
+            
+            BitMask* ResultFixer::getCandidates(ImageContext& context) throw(SDException&){
+                int rows = context.getHeight();
+                int cols = context.getWidth();
+                UNIQUE_PTR(BitMask) candidatesPtr(New BitMask(rows, cols));
+                if (useThresh){
+                    ConstColorView hlsView(context.getHLS());
+                    uchar lThreshold = lThresh;
+                    int i;
+#if defined _OPENMP_MY
+                    #pragma omp parallel for private(i)
+#endif
+                    for (i = 0; i < rows; i++){
+                        packDarkPixels(hlsView.row(i), candidatesPtr->row(i), cols, lThreshold);
+                    }
                 }
-                
-                UNIQUE_PTR(SkyDetection) skyDetection;
-                if (useSky){
-                    skyDetection = UNIQUE_PTR(SkyDetection)(New SkyDetection(originalImage));
-                    skyDetection->process();
+                else{
+                    candidatesPtr->fill(true);
                 }
-                
-                if (useThresh || useSky){
-                    for (int i = 0; i < image.rows; i++){
-                        for (int j = 0; j < image.cols; j++){
-                            Pair<uint> location((uint)j, (uint)i);
-                            uchar shadowValue = OpenCV2Tools::getChannelValue(image, location, 0);
-                            if (shadowValue > 0){                            
-                                if (useThresh){
-                                    uchar lValue = OpenCV2Tools::getChannelValue(hlsImage, location, 1);
-                                    if (lValue >= lThresh){                                
-                                        OpenCV2Tools::setChannelValue(image, location, 0, 0);
-                                    }
-                                }
-                                //sky detection
-                                if (useSky){
-                                    if (skyDetection->isSky(location) == true){
-                                        OpenCV2Tools::setChannelValue(image, location, 0, 0);
-                                    }
-                                }
-                            }
-                        }
-                    }
+                if (useSky){
+                    SkyDetection skyDetection(context);
+                    skyDetection.process();
+                    BitMask sky(*skyDetection.getDetected());
+                    candidatesPtr->andNot(sky);
                 }
+                return candidatesPtr.release();
+            }
+            
+            void ResultFixer::applyCandidates(BitMask& image, const BitMask& candidates) throw(SDException&){
+                image.andWith(candidates);
             }
             
         }
@@ -3,6 +3,8 @@
 
 #include "typedefs.h"
 #include "opencv2/core/core.hpp"
+#include "core/tools/image/ImageContext.h"
+#include "core/tools/image/BitMask.h"
 
 namespace shadowdetection{
     namespace tools{
@@ -20,8 +22,33 @@ namespace shadowdetection{
                 ResultFixer();
                 virtual ~ResultFixer();
                 
-                void applyThreshholds(  cv::Mat& image, const cv::Mat& originalImage, 
-                                        const cv::Mat& hlsImage) throw(SDException&);
+                /**
+                 * removes shadow pixels which are too light or detected as sky
+                 * @param image
+                 * shadow mask, changed in place
+                 * @param context
+                 * context of original image
+                 */
+                void applyThreshholds(  core::tools::image::BitMask& image, 
+                                        core::tools::image::ImageContext& context) throw(SDException&);
+                /**
+                 * calculates mask of pixels which can be shadow pixels after thresholds
+                 * and sky detection are applied
+                 * @param context
+                 * context of original image
+                 * @return 
+                 * mask with bits set for pixels which can be shadow. Caller is owner
+                 */
+                core::tools::image::BitMask* getCandidates(core::tools::image::ImageContext& context) throw(SDException&);
+                /**
+                 * removes shadow pixels which are not candidates
+                 * @param image
+                 * shadow mask, changed in place
+                 * @param candidates
+                 * mask returned by getCandidates()
+                 */
+                void applyCandidates(   core::tools::image::BitMask& image, 
+                                        const core::tools::image::BitMask& candidates) throw(SDException&);
             };
             
         }
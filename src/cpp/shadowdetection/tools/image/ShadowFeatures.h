@@ -0,0 +1,204 @@
+#ifndef __SHADOW_FEATURES_H__
+#define __SHADOW_FEATURES_H__
+
+#include <string>
+#include <sstream>
+#include "typedefs.h"
+
+namespace shadowdetection{
+    namespace tools{
+        namespace image{
+
+            /**
+             * indexes of images from which features are extracted, same order as
+             * images vector passed to IImageParameteres::getImageParameters
+             */
+            enum FEATURE_SOURCE{
+                FEATURE_SOURCE_BGR = 0,
+                FEATURE_SOURCE_HSV,
+                FEATURE_SOURCE_HLS,
+                FEATURE_SOURCE_COUNT
+            };
+
+            /**
+             * helper for OpenCL code generation, name of uchar3 component for channel index
+             */
+            inline const char* clComponent(uint channel){
+                static const char* components[] = {"x", "y", "z"};
+                return components[channel];
+            }
+
+            /**
+             * feature is channel value divided by scale and clamped to [0, 1]
+             */
+            template<uint Channel, uint Scale> struct ChannelFeature{
+                static inline float compute(const unsigned char* pix){
+                    float val = (float)pix[Channel] / (float)Scale;
+                    return clamp<float>(val, 0.f, 1.f);
+                }
+
+                static std::string clExpression(const std::string& pix){
+                    std::stringstream ss;
+                    ss << "clamp((float)" << pix << "." << clComponent(Channel) << " / " << Scale << ".f, 0.f, 1.f)";
+                    return ss.str();
+                }
+            };
+
+            /**
+             * feature is sum of two channel values divided by scale and clamped to [0, 1]
+             */
+            template<uint Channel1, uint Channel2, uint Scale> struct SumFeature{
+                static inline float compute(const unsigned char* pix){
+                    float val = (float)(pix[Channel1] + pix[Channel2]) / (float)Scale;
+                    return clamp<float>(val, 0.f, 1.f);
+                }
+
+                static std::string clExpression(const std::string& pix){
+                    std::stringstream ss;
+                    ss << "clamp((float)(" << pix << "." << clComponent(Channel1) << " + "
+                       << pix << "." << clComponent(Channel2) << ") / " << Scale << ".f, 0.f, 1.f)";
+                    return ss.str();
+                }
+            };
+
+            /**
+             * feature is ratio of two channels (second is increased by one)
+             * divided by scale and clamped to [0, 1]
+             */
+            template<uint Numerator, uint Denominator, uint Scale> struct RatioFeature{
+                static inline float compute(const unsigned char* pix){
+                    float val = (float)pix[Numerator] / (float)(pix[Denominator] + 1);
+                    val /= (float)Scale;
+                    return clamp<float>(val, 0.f, 1.f);
+                }
+
+                static std::string clExpression(const std::string& pix){
+                    std::stringstream ss;
+                    ss << "clamp((float)" << pix << "." << clComponent(Numerator) << " / (float)("
+                       << pix << "." << clComponent(Denominator) << " + 1) / " << Scale << ".f, 0.f, 1.f)";
+                    return ss.str();
+                }
+            };
+
+            /**
+             * list of features calculated from single image (color space).
+             * Width is known at compile time, so extraction is fully unrolled
+             */
+            template<uint Source, typename... Features> struct ColorSpaceFeatures;
+
+            template<uint Source> struct ColorSpaceFeatures<Source>{
+                static constexpr uint width = 0;
+
+                static inline void extract(const unsigned char* pix, float* row){
+                }
+
+                static void clSource(std::stringstream& ss, const std::string& pix, uint offset){
+                }
+            };
+
+            template<uint Source, typename First, typename... Rest> struct ColorSpaceFeatures<Source, First, Rest...>{
+                static constexpr uint source = Source;
+                static constexpr uint width = 1 + ColorSpaceFeatures<Source, Rest...>::width;
+
+                static inline void extract(const unsigned char* pix, float* row){
+                    row[0] = First::compute(pix);
+                    ColorSpaceFeatures<Source, Rest...>::extract(pix, row + 1);
+                }
+
+                static void clSource(std::stringstream& ss, const std::string& pix, uint offset){
+                    ss << "        currRow[" << offset << "] = " << First::clExpression(pix) << ";\n";
+                    ColorSpaceFeatures<Source, Rest...>::clSource(ss, pix, offset + 1);
+                }
+            };
+
+            /**
+             * complete list of features for single pixel, concatenation of
+             * color space feature lists
+             */
+            template<typename... Spaces> struct FeatureList;
+
+            template<> struct FeatureList<>{
+                static constexpr uint width = 0;
+
+                static inline void extract(const unsigned char* const* pixels, float* row){
+                }
+
+                static void clSource(std::stringstream& ss, uint offset){
+                }
+            };
+
+            template<typename First, typename... Rest> struct FeatureList<First, Rest...>{
+                static constexpr uint width = First::width + FeatureList<Rest...>::width;
+
+                /**
+                 *
+                 * @param pixels
+                 * pointers to current pixel in each source image, indexed by FEATURE_SOURCE
+                 * @param row
+                 * output row, must have at least width elements
+                 */
+                static inline void extract(const unsigned char* const* pixels, float* row){
+                    First::extract(pixels[First::source], row);
+                    FeatureList<Rest...>::extract(pixels, row + First::width);
+                }
+
+                static void clSource(std::stringstream& ss, uint offset){
+                    std::stringstream pix;
+                    pix << "pix" << First::source;
+                    First::clSource(ss, pix.str(), offset);
+                    FeatureList<Rest...>::clSource(ss, offset + First::width);
+                }
+
+                /**
+                 * generates OpenCL kernel which calculates same features as extract()
+                 * @param kernelName
+                 * name of generated kernel
+                 * @return
+                 * kernel source, expects getPixel() helper to be defined before
+                 */
+                static std::string clKernel(const std::string& kernelName){
+                    std::stringstream ss;
+                    ss << "\n__kernel void " << kernelName << "(__global float* retMatrix, const uint numOfParameters,\n"
+                       << "                                    __global uchar* originalImage, __global uchar* hsvImage,\n"
+                       << "                                    __global uchar* hlsImage, const uint numOfPixels){\n"
+                       << "    int currIndex = get_global_id(0);\n"
+                       << "    if (currIndex < numOfPixels){\n"
+                       << "        uchar3 pix" << FEATURE_SOURCE_BGR << " = getPixel(originalImage, currIndex);\n"
+                       << "        uchar3 pix" << FEATURE_SOURCE_HSV << " = getPixel(hsvImage, currIndex);\n"
+                       << "        uchar3 pix" << FEATURE_SOURCE_HLS << " = getPixel(hlsImage, currIndex);\n"
+                       << "        __global float* currRow = retMatrix + currIndex * " << width << ";\n";
+                    clSource(ss, 0);
+                    ss << "    }\n}\n";
+                    return ss.str();
+                }
+            };
+
+            //H, S, V channel order
+            typedef ColorSpaceFeatures< FEATURE_SOURCE_HSV,
+                                        ChannelFeature<1, 255>,
+                                        ChannelFeature<2, 255>,
+                                        RatioFeature<0, 1, 180>,
+                                        RatioFeature<0, 2, 180>,
+                                        RatioFeature<1, 2, 255> > HSVFeatures;
+            //H, L, S channel order
+            typedef ColorSpaceFeatures< FEATURE_SOURCE_HLS,
+                                        ChannelFeature<1, 255>,
+                                        ChannelFeature<2, 255>,
+                                        RatioFeature<0, 1, 180>,
+                                        RatioFeature<0, 2, 180>,
+                                        RatioFeature<1, 2, 255> > HLSFeatures;
+            //B, G, R channel order
+            typedef ColorSpaceFeatures< FEATURE_SOURCE_BGR,
+                                        ChannelFeature<0, 255>,
+                                        SumFeature<1, 2, 510> > BGRFeatures;
+
+            /**
+             * features used for shadow detection, order must match order of trained model coefficients
+             */
+            typedef FeatureList<HSVFeatures, HLSFeatures, BGRFeatures> ShadowFeatures;
+
+        }
+    }
+}
+
+#endif
@@ -1,7 +1,14 @@
 #include "SkyDetection.h"
 #include "core/util/Config.h"
+#include "core/tools/image/Morphology.h"
 #include <string>
 #include <memory>
+#if defined _OPENMP_MY
+#include <omp.h>
+#endif
+
+//maximum difference of sky pixel channel from mean of largest segment
+#define SKY_RANGE_DELTA 50.f
 
 namespace skydetection{
     
@@ -10,10 +17,35 @@ namespace skydetection{
     using namespace std;
     using namespace core::opencv2;
     using namespace core::util::raii;    
+    using namespace core::tools::image;
+    
+    /**
+     * branch free sky candidate test
+     * @return 
+     * 1 if pixel is sky candidate, 0 otherwise
+     */
+    inline uint skyCandidate(const uchar* bgr, uint lValue, uint rThresh, uint bThresh, uint lThresh){
+        uint bValue = bgr[0];
+        uint gValue = bgr[1];
+        uint rValue = bgr[2];
+        return ((rValue <= rThresh) | (rValue <= bValue / 3U)) & (gValue >= bValue / 6U) &
+               (gValue <= bValue) & (bValue >= bThresh) & (lValue >= lThresh);
+    }
+    
+    /**
+     * @return 
+     * 1 if all channels are within SKY_RANGE_DELTA of mean, 0 otherwise
+     */
+    inline uint inSkyRange(const uchar* bgr, const Triple<float>& mean){
+        return (fabs((float)bgr[0] - mean.getFirst()) <= SKY_RANGE_DELTA) &
+               (fabs((float)bgr[1] - mean.getSecond()) <= SKY_RANGE_DELTA) &
+               (fabs((float)bgr[2] - mean.getThird()) <= SKY_RANGE_DELTA);
+    }
     
     void SkyDetection::initBaseVariables(){
-        originalImage = 0;        
+        context = 0;
         detectedImage = 0;
+        rangeApplied = false;
         
         Config* conf = Config::getInstancePtr();
         string rThreshStr = conf->getPropertyValue("skyDetection.Thresholds.rValue");
@@ -22,107 +54,168 @@ namespace skydetection{
         bThresh = (uchar)atoi(bThreshStr.c_str());
         string lThreshStr = conf->getPropertyValue("skyDetection.Thresholds.lValue");
         lThresh = (uchar)atoi(lThreshStr.c_str());
+        string scaleStr = conf->getPropertyValue("skyDetection.scale");
+        scale = atoi(scaleStr.c_str());
     }
     
     SkyDetection::SkyDetection(){
         initBaseVariables();
     }
     
-    SkyDetection::SkyDetection(const Mat& originalImage){
+    SkyDetection::SkyDetection(ImageContext& context){
         initBaseVariables();
-        this->originalImage = New Mat(originalImage);
+        this->context = &context;
     }
     
     SkyDetection::~SkyDetection(){
-        if (originalImage != 0)
-            Delete(originalImage);
         if (detectedImage != 0)
             Delete(detectedImage);
     }
     
-    Triple<float> SkyDetection::getMeanBGRValuesOfSegment(unordered_set< Pair<uint> >* segment){
-        float avgB = 0.f, avgG = 0.f, avgR = 0.f;
-        unordered_set< Pair<uint> >::iterator iter = segment->begin();
-        while (iter != segment->end()){
-            Pair<uint> location = *iter;
-            avgB += (float)OpenCV2Tools::getChannelValue(*originalImage, location, 0);
-            avgG += (float)OpenCV2Tools::getChannelValue(*originalImage, location, 1);
-            avgR += (float)OpenCV2Tools::getChannelValue(*originalImage, location, 2);
-            iter++;
+    void SkyDetection::processSegments(){
+        ConnectedComponents components;
+        components.label(*detectedImage, 255, &context->getOriginal());
+        if (components.getRegionCount() > 1){
+            //mean values of largest segment
+            skyMean = components.getRegion(components.getLargestRegion()).getMeanBGR();
+            rangeApplied = true;
+            reduceInSegments(components, skyMean);
         }
-        avgB /= (float)segment->size();
-        avgG /= (float)segment->size();
-        avgR /= (float)segment->size();
-        Triple<float> retVal(avgB, avgG, avgR);
-        return retVal;
     }
     
-    void SkyDetection::processSegments(){
-        list< unordered_set< Pair<uint> >* >* segments = OpenCV2Tools::getRegionsOfColor(*detectedImage, 255);
-        if (segments->size() > 1){
-            list< unordered_set< Pair<uint> >* >::iterator iter = segments->begin();
-            //largest segment
-            unordered_set< Pair<uint> >* segment = *iter;
-            Triple<float> meanValues = getMeanBGRValuesOfSegment(segment);
-            while (iter != segments->end()){
-                segment = *iter;
-                reduceInSegment(segment, meanValues);
-                iter++;
+    void SkyDetection::reduceInSegments(const ConnectedComponents& components, const Triple<float>& thresHold){
+        ConstColorView originalView(context->getOriginal());
+        ConstLabelView labelsView(components.getLabels());
+        MaskView detectedView(*detectedImage);
+        int rows = labelsView.getRows();
+        int cols = labelsView.getCols();
+        int i;
+#if defined _OPENMP_MY
+        #pragma omp parallel for private(i)
+#endif
+        for (i = 0; i < rows; i++){
+            const int* labelsRow = labelsView.row(i);
+            const uchar* originalRow = originalView.row(i);
+            uchar* detectedRow = detectedView.row(i);
+            for (int j = 0; j < cols; j++){
+                uint inRange = inSkyRange(originalRow + j * 3, thresHold);
+                //labeled pixels out of range are removed
+                uint reduce = (labelsRow[j] != 0) & (inRange ^ 1U);
+                detectedRow[j] &= (uchar)(reduce - 1U);
             }
         }
-        OpenCV2Tools::destroySegments(segments);
     }
     
-    void SkyDetection::reduceInSegment(unordered_set< Pair<uint> >* segment, const Triple<float>& thresHold){
-        unordered_set< Pair<uint> >::iterator iter = segment->begin();
-        while (iter != segment->end()){
-            Pair<uint> location = *iter;
-            uint bValue = OpenCV2Tools::getChannelValue(*originalImage, location, 0);
-            uint gValue = OpenCV2Tools::getChannelValue(*originalImage, location, 1);
-            uint rValue = OpenCV2Tools::getChannelValue(*originalImage, location, 2);
-            float delta = 50.f;
-            if (inEpsilonRange<float>((float)bValue, thresHold.getFirst(), delta) == false ||
-                inEpsilonRange<float>((float)gValue, thresHold.getSecond(), delta) == false ||
-                inEpsilonRange<float>((float)rValue, thresHold.getThird(), delta) == false){
-                OpenCV2Tools::setChannelValue(*detectedImage, location, 0, 0U);
+    void SkyDetection::calculateCandidates() throw (SDException&){
+        const Mat* originalImage = &context->getOriginal();
+        UNIQUE_PTR(Mat) candidatesPtr(OpenCV2Tools::get8bitImage(originalImage->rows, originalImage->cols));
+        if (candidatesPtr.get() == 0 || candidatesPtr->data == 0){
+            SDException exc(SHADOW_INVALID_IMAGE_FORMAT, "SkyDetection::calculateCandidates");
+            throw exc;
+        }
+        ConstColorView originalView(*originalImage);
+        ConstColorView hlsView(context->getHLS());
+        MaskView candidatesView(*candidatesPtr);
+        int rows = originalView.getRows();
+        int cols = originalView.getCols();
+        //loop body is branch free so it can be vectorized
+        int i;
+#if defined _OPENMP_MY
+        #pragma omp parallel for private(i)
+#endif
+        for (i = 0; i < rows; i++){
+            const uchar* originalRow = originalView.row(i);
+            const uchar* hlsRow = hlsView.row(i);
+            uchar* candidatesRow = candidatesView.row(i);
+            for (int j = 0; j < cols; j++){
+                uint isSky = skyCandidate(originalRow + j * 3, hlsRow[j * 3 + 1], rThresh, bThresh, lThresh);
+                candidatesRow[j] = (uchar)(0U - isSky);
             }
-            iter++;
         }
+        context->setSkyCandidates(candidatesPtr.release());
     }
     
-    void SkyDetection::process() throw (SDException&){
-        if (originalImage == 0 || originalImage->data == 0){
-            SDException exc(SHADOW_INVALID_IMAGE_FORMAT, "SkyDetection::isSky");
-            throw exc;
+    void SkyDetection::processFull() throw (SDException&){
+        if (context->hasSkyCandidates() == false){
+            calculateCandidates();
         }
-        detectedImage = OpenCV2Tools::get8bitImage(originalImage->rows, originalImage->cols);
-        if (detectedImage == 0 || detectedImage->data == 0){
-            SDException exc(SHADOW_INVALID_IMAGE_FORMAT, "SkyDetection::isSky");
-            throw exc;
+        if (detectedImage != 0)
+            Delete(detectedImage);
+        //segments processing changes detected image, candidates in context stay untouched
+        detectedImage = New Mat(context->getSkyCandidates().clone());
+        processSegments();        
+    }
+    
+    void SkyDetection::processReduced() throw (SDException&){
+        const Mat& originalImage = context->getOriginal();
+        int rows = originalImage.rows;
+        int cols = originalImage.cols;
+        Mat reducedImage;
+        resize(originalImage, reducedImage, Size(cols / scale, rows / scale), 0, 0, INTER_AREA);
+        UNIQUE_PTR(Mat) reducedDetectedPtr;
+        Mat borders;
+        {
+            ImageContext reducedContext(reducedImage);
+            SkyDetection reducedDetection(reducedContext);
+            reducedDetection.processFull();
+            rangeApplied = reducedDetection.rangeApplied;
+            skyMean = reducedDetection.skyMean;
+            const Mat& reducedDetected = *reducedDetection.getDetected();
+            //reduced pixel is on border if there are both sky and non sky pixels around it
+            Mat dilated, eroded;
+            Morphology morphology;
+            morphology.dilate(reducedDetected, dilated, 3, 3);
+            morphology.erode(reducedDetected, eroded, 3, 3);
+            Mat reducedBorders = dilated != eroded;
+            resize(reducedBorders, borders, Size(cols, rows), 0, 0, INTER_NEAREST);
+            reducedDetectedPtr = UNIQUE_PTR(Mat)(New Mat());
+            resize(reducedDetected, *reducedDetectedPtr, Size(cols, rows), 0, 0, INTER_NEAREST);
         }
-        UNIQUE_PTR(Mat) hlsImagePtr(OpenCV2Tools::convertToHLS(originalImage));
-        if (hlsImagePtr.get() == 0 || hlsImagePtr->data == 0){
-            SDException exc(SHADOW_INVALID_IMAGE_FORMAT, "SkyDetection::isSky");
-            throw exc;
-        }        
-        for (int i = 0; i < originalImage->rows; i++){
-            for (int j = 0; j < originalImage->cols; j++){
-                Pair<uint> location((uint)j, (uint)i);
-                uchar rValue = OpenCV2Tools::getChannelValue(*originalImage, location, 2);
-                uchar gValue = OpenCV2Tools::getChannelValue(*originalImage, location, 1);
-                uchar bValue = OpenCV2Tools::getChannelValue(*originalImage, location, 0);
-                uchar lValue = OpenCV2Tools::getChannelValue(*hlsImagePtr, location, 1);
-                if ((rValue <= rThresh || rValue <= bValue / 3U) && (gValue >= bValue / 6U) && 
-                    gValue <= bValue && bValue >= bThresh && 
-                    lValue >= lThresh){                    
-                        OpenCV2Tools::setChannelValue(*detectedImage, location, 0, 255U);                        
-                }
-                else{                    
-                    OpenCV2Tools::setChannelValue(*detectedImage, location, 0, 0U);                    
-                }
+        if (detectedImage != 0)
+            Delete(detectedImage);
+        detectedImage = reducedDetectedPtr.release();
+        refineBorders(borders);
+    }
+    
+    void SkyDetection::refineBorders(const Mat& borders) throw (SDException&){
+        ConstColorView originalView(context->getOriginal());
+        ConstColorView hlsView(context->getHLS());
+        ConstMaskView bordersView(borders);
+        MaskView detectedView(*detectedImage);
+        int rows = originalView.getRows();
+        int cols = originalView.getCols();
+        uint ignoreRange = rangeApplied ? 0U : 1U;
+        int i;
+#if defined _OPENMP_MY
+        #pragma omp parallel for private(i)
+#endif
+        for (i = 0; i < rows; i++){
+            const uchar* originalRow = originalView.row(i);
+            const uchar* hlsRow = hlsView.row(i);
+            const uchar* bordersRow = bordersView.row(i);
+            uchar* detectedRow = detectedView.row(i);
+            for (int j = 0; j < cols; j++){
+                if (bordersRow[j] == 0)
+                    continue;
+                //same test as full resolution candidates and segment reduction
+                const uchar* pixel = originalRow + j * 3;
+                uint isSky = skyCandidate(pixel, hlsRow[j * 3 + 1], rThresh, bThresh, lThresh) &
+                             (inSkyRange(pixel, skyMean) | ignoreRange);
+                detectedRow[j] = (uchar)(0U - isSky);
             }
         }
-        processSegments();        
+    }
+    
+    void SkyDetection::process() throw (SDException&){
+        if (context == 0 || context->getOriginal().data == 0){
+            SDException exc(SHADOW_INVALID_IMAGE_FORMAT, "SkyDetection::process");
+            throw exc;
+        }
+        const Mat& originalImage = context->getOriginal();
+        if (scale > 1 && originalImage.rows >= scale * 3 && originalImage.cols >= scale * 3)
+            processReduced();
+        else
+            processFull();
     }
     
     bool SkyDetection::isSky(Pair<uint> location) throw (SDException&){
@@ -3,30 +3,47 @@
 
 #include "typedefs.h"
 #include "core/opencv/OpenCV2Tools.h"
-#include <unordered_set>
+#include "core/tools/image/ImageContext.h"
+#include "core/tools/image/ConnectedComponents.h"
+#include "core/tools/image/ImageView.h"
 
 namespace skydetection{
     
     /**
-     conatins a copy of originalImage
+     works on image from context, sky candidates are stored in context.
+     If skyDetection.scale is greater than 1 candidates and segments are processed
+     on reduced image, detected mask is scaled back and only pixels along sky
+     borders are tested again in full resolution
      */
     class SkyDetection{
     private:
         uchar rThresh;        
         uchar bThresh;
         uchar lThresh;
+        int scale;
         
-        cv::Mat* originalImage;        
+        core::tools::image::ImageContext* context;
         cv::Mat* detectedImage;
+        //true if pixels of segments are reduced to range around skyMean
+        bool rangeApplied;
+        Triple<float> skyMean;
         
         void initBaseVariables();
+        void calculateCandidates() throw (SDException&);
         void processSegments();
-        Triple<float> getMeanBGRValuesOfSegment(std::unordered_set< Pair<uint> >* segment);
-        void reduceInSegment(std::unordered_set< Pair<uint> >* segment, const Triple<float>& thresHold);
+        void reduceInSegments(const core::tools::image::ConnectedComponents& components, const Triple<float>& thresHold);
+        void processFull() throw (SDException&);
+        void processReduced() throw (SDException&);
+        void refineBorders(const cv::Mat& borders) throw (SDException&);
     protected:
     public:
         SkyDetection();
-        SkyDetection(const cv::Mat& originalImage);
+        /**
+         * 
+         * @param context
+         * context of image being processed, must live longer than this instance
+         */
+        SkyDetection(core::tools::image::ImageContext& context);
         virtual ~SkyDetection();
         
         void process() throw (SDException&);
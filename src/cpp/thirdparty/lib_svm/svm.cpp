@@ -10,6 +10,10 @@
 #include "svm.h"
 #include "core/opencl/libsvm/OpenCLToolsTrain.h"
 #include "core/util/Matrix.h"
+#include "core/util/Timer.h"
+#if defined _OPENMP_MY
+#include <omp.h>
+#endif
 
 #ifdef _OPENCL
 using namespace core::opencl::libsvm;
@@ -55,6 +59,17 @@ static inline double powi(double base, int times) {
 }
 #define INF HUGE_VAL
 #define TAU 1e-12
+// number of kernel column elements computed together by dense backend
+#define DENSE_BLOCK 256
+// alignment of dense feature rows in bytes
+#define DENSE_ALIGN 64
+// solver loops over fewer elements run in one thread, can be set at build time
+// to compare thresholds with src/gnuplot/benchmarkSolver.sh
+#ifndef SOLVER_PARALLEL_MIN
+#define SOLVER_PARALLEL_MIN 8192
+#endif
+// kernel cache columns are allocated in slabs of about this size
+#define CACHE_SLAB_BYTES (16L << 20)
 #define Malloc(type,n) (type *)malloc((n)*sizeof(type))
 
 static void print_string_stdout(const char *s) {
@@ -62,9 +77,13 @@ static void print_string_stdout(const char *s) {
     fflush(stdout);
 }
 static void (*svm_print_string) (const char *) = &print_string_stdout;
+// set for thread running svm_train with param->quiet, output is printed by that thread only
+static thread_local bool svm_quiet = false;
 #if 1
 
 static void info(const char *fmt, ...) {
+    if (svm_quiet)
+        return;
     char buf[BUFSIZ];
     va_list ap;
     va_start(ap, fmt);
@@ -84,6 +103,12 @@ static void info(const char *fmt, ...) {
 // l is the number of total data items
 // size is the cache size limit in bytes
 //
+// columns are kept in fixed slots of l values, slots are allocated in slabs
+// when first needed and reused after eviction, so no column is reallocated.
+// swap_index only exchanges slots of columns i and j and records the swap,
+// rows of cached columns are swapped when column is requested again.
+// Column which misses more than l recorded swaps is dropped
+//
 
 class Cache {
 public:
@@ -97,31 +122,67 @@ public:
     void swap_index(int i, int j);
 private:
     int l;
-    long int size;
+    int slots; // maximal number of cached columns
+    int usedSlots;
+    int slabColumns;
+    Qfloat **slabs;
+    int *freeSlots;
+    int freeCount;
 
     struct head_t {
         head_t *prev, *next; // a circular list
-        Qfloat *data;
+        int slot; // -1 if column is not cached
         int len; // data[0,len) is cached in this entry
+        long int version; // number of recorded swaps applied to column
     };
 
     head_t *head;
     head_t lru_head;
+    // ring buffer of last l swaps, pair (i, j) with i < j
+    int *swaps;
+    long int swapCount;
+
+    long int hits;
+    long int misses;
+    long int evictions;
+    long int computed;
+
     void lru_delete(head_t *h);
     void lru_insert(head_t *h);
+    Qfloat *column(int slot);
+    int take_slot();
+    void release(head_t *h);
+    bool apply_swaps(head_t *h);
 };
 
-Cache::Cache(int l_, long int size_) : l(l_), size(size_) {
+Cache::Cache(int l_, long int size) : l(l_) {
     head = (head_t *) calloc(l, sizeof (head_t)); // initialized to 0
-    size /= sizeof (Qfloat);
-    size -= l * sizeof (head_t) / sizeof (Qfloat);
-    size = max(size, 2 * (long int) l); // cache must be large enough for two columns
+    for (int i = 0; i < l; i++)
+        head[i].slot = -1;
+    size -= l * (sizeof (head_t) + 2 * sizeof (int));
+    long int columns = size / ((long int) sizeof (Qfloat) * l);
+    columns = min(columns, (long int) l);
+    slots = (int) max(columns, 2L); // cache must be large enough for two columns
+    slabColumns = (int) max(1L, min((long int) slots, CACHE_SLAB_BYTES / ((long int) sizeof (Qfloat) * l)));
+    slabs = (Qfloat **) calloc((slots + slabColumns - 1) / slabColumns, sizeof (Qfloat *));
+    freeSlots = (int *) malloc(sizeof (int) * slots);
+    swaps = (int *) malloc(sizeof (int) * 2 * l);
+    usedSlots = 0;
+    freeCount = 0;
+    swapCount = 0;
+    hits = misses = evictions = computed = 0;
     lru_head.next = lru_head.prev = &lru_head;
 }
 
 Cache::~Cache() {
-    for (head_t *h = lru_head.next; h != &lru_head; h = h->next)
-        free(h->data);
+    long int requests = hits + computed;
+    info("cache: %d columns, hits = %ld (%.1f%%), misses = %ld, evictions = %ld, computed = %ld\n",
+            slots, hits, (requests > 0) ? 100.0 * hits / requests : 0.0, misses, evictions, computed);
+    for (int i = 0; i < (slots + slabColumns - 1) / slabColumns; i++)
+        free(slabs[i]);
+    free(slabs);
+    free(freeSlots);
+    free(swaps);
     free(head);
 }
 
@@ -139,58 +200,104 @@ void Cache::lru_insert(head_t *h) {
     h->next->prev = h;
 }
 
-int Cache::get_data(const int index, Qfloat **data, int len) {
-    head_t *h = &head[index];
-    if (h->len) lru_delete(h);
-    int more = len - h->len;
+Qfloat *Cache::column(int slot) {
+    return slabs[slot / slabColumns] + (size_t) (slot % slabColumns) * l;
+}
 
-    if (more > 0) {
-        // free old space
-        while (size < more) {
-            head_t *old = lru_head.next;
-            lru_delete(old);
-            free(old->data);
-            size += old->len;
-            old->data = 0;
-            old->len = 0;
-        }
+int Cache::take_slot() {
+    if (freeCount > 0)
+        return freeSlots[--freeCount];
+    if (usedSlots < slots) {
+        int slot = usedSlots++;
+        if (slot % slabColumns == 0)
+            slabs[slot / slabColumns] = (Qfloat *) malloc(sizeof (Qfloat) * slabColumns * l);
+        return slot;
+    }
+    // reuse least recently used column
+    head_t *old = lru_head.next;
+    lru_delete(old);
+    int slot = old->slot;
+    old->slot = -1;
+    old->len = 0;
+    evictions++;
+    return slot;
+}
+
+void Cache::release(head_t *h) {
+    freeSlots[freeCount++] = h->slot;
+    h->slot = -1;
+    h->len = 0;
+}
 
-        // allocate new space
-        h->data = (Qfloat *) realloc(h->data, sizeof (Qfloat) * len);
-        size -= more;
-        swap(h->len, len);
+bool Cache::apply_swaps(head_t *h) {
+    if (swapCount - h->version > l)
+        return false;
+    Qfloat *data = column(h->slot);
+    for (long int s = h->version; s < swapCount; s++) {
+        int i = swaps[2 * (s % l)];
+        int j = swaps[2 * (s % l) + 1];
+        if (h->len > j)
+            swap(data[i], data[j]);
+        else if (h->len > i)
+            h->len = i; // data[j] was not computed, keep part before i
+    }
+    h->version = swapCount;
+    return true;
+}
+
+int Cache::get_data(const int index, Qfloat **data, int len) {
+    head_t *h = &head[index];
+    if (h->slot >= 0) {
+        lru_delete(h);
+        if (apply_swaps(h) == false)
+            release(h);
+    }
+    if (h->slot < 0) {
+        h->slot = take_slot();
+        h->len = 0;
+        h->version = swapCount;
+        misses++;
+    }
+
+    int start = h->len;
+    if (start < len) {
+        h->len = len;
+        computed++;
+    } else {
+        start = len;
+        hits++;
     }
 
     lru_insert(h);
-    *data = h->data;
-    return len;
+    *data = column(h->slot);
+    return start;
 }
 
 void Cache::swap_index(int i, int j) {
     if (i == j) return;
 
-    if (head[i].len) lru_delete(&head[i]);
-    if (head[j].len) lru_delete(&head[j]);
-    swap(head[i].data, head[j].data);
+    if (head[i].slot >= 0) lru_delete(&head[i]);
+    if (head[j].slot >= 0) lru_delete(&head[j]);
+    swap(head[i].slot, head[j].slot);
     swap(head[i].len, head[j].len);
-    if (head[i].len) lru_insert(&head[i]);
-    if (head[j].len) lru_insert(&head[j]);
+    swap(head[i].version, head[j].version);
+    if (head[i].slot >= 0) lru_insert(&head[i]);
+    if (head[j].slot >= 0) lru_insert(&head[j]);
 
     if (i > j) swap(i, j);
-    for (head_t *h = lru_head.next; h != &lru_head; h = h->next) {
-        if (h->len > i) {
-            if (h->len > j)
-                swap(h->data[i], h->data[j]);
-            else {
-                // give up
-                lru_delete(h);
-                free(h->data);
-                size += h->len;
-                h->data = 0;
-                h->len = 0;
-            }
-        }
+    swaps[2 * (swapCount % l)] = i;
+    swaps[2 * (swapCount % l) + 1] = j;
+    swapCount++;
+}
+
+// writes row of source as dim + 1 svm_nodes, features with zero value are kept
+static svm_node *source_row(const svm_row_source *source, int row, svm_node *buffer) {
+    for (int k = 0; k < source->dim; k++) {
+        buffer[k].index = k + 1;
+        buffer[k].value = source->get_value(source->data, row, k);
     }
+    buffer[source->dim].index = -1;
+    return buffer;
 }
 
 //
@@ -200,6 +307,11 @@ void Cache::swap_index(int i, int j) {
 // the constructor of Kernel prepares to calculate the l*l kernel matrix
 // the member function get_Q is for getting one column from the Q Matrix
 //
+// when all rows have the same index set (no missing features) Kernel keeps
+// features in dense aligned matrix, stored feature by feature, so one column
+// is computed for many j at once with vector instructions. Rows of problem
+// with svm_row_source go straight to dense matrix, without svm_node copy
+//
 
 class QMatrix {
 public:
@@ -213,7 +325,7 @@ public:
 
 class Kernel : public QMatrix {
 public:
-    Kernel(int l, svm_node * const * x, const svm_parameter& param);
+    Kernel(int l, svm_node * const * x, const svm_row_source *source, const svm_parameter& param);
     virtual ~Kernel();
 
     static double k_function(const svm_node *x, const svm_node *y,
@@ -224,7 +336,11 @@ public:
     virtual void swap_index(int i, int j) const // no so const...
     {
         //swap((*x)[i], (*x)[j]);
-        x->swap(i, j);
+        if (dense) {
+            for (int k = 0; k < denseDim; k++)
+                swap(dense[(size_t) k * denseStride + i], dense[(size_t) k * denseStride + j]);
+        } else
+            x->swap(i, j);
         if (x_square) swap(x_square[i], x_square[j]);
     }
 protected:
@@ -240,23 +356,44 @@ protected:
     const double gamma;
     const double coef0;
     double *x_square;
+
+    // dense backend, value k of row j is dense[k * denseStride + j], NULL for sparse data
+    double *dense;
+    int denseDim;
+    int denseStride;
+
+    // kernel values K(i, j) for j in [start, end), multiplied by y[i] * y[j] when y is not NULL
+    void dense_column(int i, int start, int end, const schar *y, Qfloat *data) const;
 private:
     static double dot(const svm_node *px, const svm_node *py);
+    static bool same_indices(int l, svm_node * const * x);
+    void init_dense(int l, svm_node * const * x, const svm_row_source *source);
+
+    double dense_dot(int i, int j) const {
+        double sum = 0;
+        for (int k = 0; k < denseDim; k++)
+            sum += dense[(size_t) k * denseStride + i] * dense[(size_t) k * denseStride + j];
+        return sum;
+    }
+
+    double dot(int i, int j) const {
+        return dense ? dense_dot(i, j) : dot((*x)(i), (*x)(j));
+    }
 
     double kernel_linear(int i, int j) const {
-        return dot((*x)(i), (*x)(j));
+        return dot(i, j);
     }
 
     double kernel_poly(int i, int j) const {
-        return powi(gamma * dot((*x)(i), (*x)(j)) + coef0, degree);
+        return powi(gamma * dot(i, j) + coef0, degree);
     }
 
     double kernel_rbf(int i, int j) const {
-        return exp(-gamma * (x_square[i] + x_square[j] - 2 * dot((*x)(i), (*x)(j))));
+        return exp(-gamma * (x_square[i] + x_square[j] - 2 * dot(i, j)));
     }
 
     double kernel_sigmoid(int i, int j) const {
-        return tanh(gamma * dot((*x)(i), (*x)(j)) + coef0);
+        return tanh(gamma * dot(i, j) + coef0);
     }
 
     double kernel_precomputed(int i, int j) const {
@@ -264,7 +401,7 @@ private:
     }
 };
 
-Kernel::Kernel(int l, svm_node * const * x_, const svm_parameter& param)
+Kernel::Kernel(int l, svm_node * const * x_, const svm_row_source *source, const svm_parameter& param)
 : kernel_type(param.kernel_type), degree(param.degree),
 gamma(param.gamma), coef0(param.coef0) {
     switch (kernel_type) {
@@ -285,20 +422,36 @@ gamma(param.gamma), coef0(param.coef0) {
             break;
     }
 
-    const svm_node *px = x_[0];
     kW = 1;
-    while (px->index != -1){
-        ++kW;
-        ++px;
-    } 
+    if (source)
+        kW = source->dim + 1;
+    else {
+        const svm_node *px = x_[0];
+        while (px->index != -1){
+            ++kW;
+            ++px;
+        }
+    }
     
-    //clone(x, x_, l);
-    x = new Matrix<svm_node>(x_, kW, l);
+    x = 0;
+    dense = 0;
+    denseDim = 0;
+    denseStride = 0;
+    //OpenCL get_Q works on svm_node matrix
+#ifndef _OPENCL
+    if (source)
+        init_dense(l, x_, source);
+    else if (kernel_type != PRECOMPUTED && same_indices(l, x_))
+        init_dense(l, x_, NULL);
+    else
+#endif
+        //clone(x, x_, l);
+        x = new Matrix<svm_node>(x_, kW, l);
 
     if (kernel_type == RBF) {
         x_square = new double[l];
         for (int i = 0; i < l; i++)
-            x_square[i] = dot((*x)(i), (*x)(i));
+            x_square[i] = dot(i, i);
     } else
         x_square = 0;
     kL = l;          
@@ -307,9 +460,112 @@ gamma(param.gamma), coef0(param.coef0) {
 Kernel::~Kernel() {
     if (x)
         delete x;
+    free(dense);
     delete[] x_square;
 }
 
+bool Kernel::same_indices(int l, svm_node * const * x) {
+    for (int i = 1; i < l; i++) {
+        const svm_node *px = x[0];
+        const svm_node *py = x[i];
+        while (px->index != -1 && px->index == py->index) {
+            ++px;
+            ++py;
+        }
+        if (px->index != -1 || py->index != -1)
+            return false;
+    }
+    return true;
+}
+
+void Kernel::init_dense(int l, svm_node * const * x_, const svm_row_source *source) {
+    denseDim = kW - 1;
+    // every feature row starts aligned
+    int perAlign = DENSE_ALIGN / sizeof (double);
+    denseStride = (l + perAlign - 1) / perAlign * perAlign;
+    void *mem = 0;
+    int i;
+    if (posix_memalign(&mem, DENSE_ALIGN, sizeof (double) * (size_t) denseStride * max(denseDim, 1)) != 0) {
+        // not enough memory for dense copy, stay with svm_node matrix
+        if (source) {
+            svm_node *rows = Malloc(svm_node, (size_t) l * kW);
+            svm_node **row_ptrs = Malloc(svm_node *, l);
+            for (i = 0; i < l; i++)
+                row_ptrs[i] = source_row(source, (int) x_[i]->value, &rows[(size_t) i * kW]);
+            x = new Matrix<svm_node>(row_ptrs, kW, l);
+            free(row_ptrs);
+            free(rows);
+        } else
+            x = new Matrix<svm_node>(x_, kW, l);
+        denseDim = 0;
+        denseStride = 0;
+        return;
+    }
+    dense = (double *) mem;
+#if defined _OPENMP_MY
+#pragma omp parallel for private(i)
+#endif
+    for (i = 0; i < l; i++) {
+        if (source) {
+            int row = (int) x_[i]->value;
+            for (int k = 0; k < denseDim; k++)
+                dense[(size_t) k * denseStride + i] = source->get_value(source->data, row, k);
+        } else {
+            for (int k = 0; k < denseDim; k++)
+                dense[(size_t) k * denseStride + i] = x_[i][k].value;
+        }
+    }
+}
+
+void Kernel::dense_column(int i, int start, int end, const schar *y, Qfloat *data) const {
+    int blocks = (end - start + DENSE_BLOCK - 1) / DENSE_BLOCK;
+    int b;
+#if defined _OPENMP_MY
+#pragma omp parallel for private(b)
+#endif
+    for (b = 0; b < blocks; b++) {
+        int first = start + b * DENSE_BLOCK;
+        int n = min(DENSE_BLOCK, end - first);
+        double sum[DENSE_BLOCK];
+        for (int t = 0; t < n; t++)
+            sum[t] = 0;
+        // same summation order as dot, so values equal the sparse ones
+        for (int k = 0; k < denseDim; k++) {
+            const double *row = dense + (size_t) k * denseStride;
+            const double xik = row[i];
+            const double *xj = row + first;
+#if defined _OPENMP_MY
+#pragma omp simd
+#endif
+            for (int t = 0; t < n; t++)
+                sum[t] += xik * xj[t];
+        }
+        switch (kernel_type) {
+            case LINEAR:
+                break;
+            case POLY:
+                for (int t = 0; t < n; t++)
+                    sum[t] = powi(gamma * sum[t] + coef0, degree);
+                break;
+            case RBF:
+                for (int t = 0; t < n; t++)
+                    sum[t] = exp(-gamma * (x_square[i] + x_square[first + t] - 2 * sum[t]));
+                break;
+            case SIGMOID:
+                for (int t = 0; t < n; t++)
+                    sum[t] = tanh(gamma * sum[t] + coef0);
+                break;
+        }
+        if (y) {
+            for (int t = 0; t < n; t++)
+                data[first + t] = (Qfloat) (y[i] * y[first + t] * sum[t]);
+        } else {
+            for (int t = 0; t < n; t++)
+                data[first + t] = (Qfloat) sum[t];
+        }
+    }
+}
+
 double Kernel::dot(const svm_node *px, const svm_node *py) {
     double sum = 0;
     while (px->index != -1 && py->index != -1) {
@@ -382,12 +638,13 @@ double Kernel::k_function(const svm_node *x, const svm_node *y,
 //
 //		y^T \alpha = \delta
 //		y_i = +1 or -1
-//		0 <= alpha_i <= Cp for y_i = 1
-//		0 <= alpha_i <= Cn for y_i = -1
+//		0 <= alpha_i <= Cp * W_i for y_i = 1
+//		0 <= alpha_i <= Cn * W_i for y_i = -1
 //
 // Given:
 //
 //	Q, p, y, Cp, Cn, and an initial feasible point \alpha
+//	W instance weights, NULL when all weights are 1
 //	l is the size of vectors and matrices
 //	eps is the stopping tolerance
 //
@@ -413,7 +670,7 @@ public:
 
     void Solve(int l, QMatrix& Q, const double *p_, const schar *y_,
             double *alpha_, double Cp, double Cn, double eps,
-            SolutionInfo* si, int shrinking);
+            SolutionInfo* si, int shrinking, const double *W_ = NULL);
 protected:
     int active_size;
     schar *y;
@@ -428,14 +685,29 @@ protected:
     const double *QD;
     double eps;
     double Cp, Cn;
+    double *W;
     double *p;
     int *active_set;
     double *G_bar; // gradient, if we treat free variables as 0
     int l;
     bool unshrink; // XXX
 
+    // partial results of one thread in parallel searches, padding keeps
+    // threads in separate cache lines
+    struct Partial {
+        double max[2];
+        int max_idx[2];
+        double min;
+        int min_idx;
+        char pad[64];
+    };
+    Partial *partial;
+    int threads;
+    char *shrink; // be_shrunk of active elements, filled by do_shrinking
+
     double get_C(int i) {
-        return (y[i] > 0) ? Cp : Cn;
+        double C = (y[i] > 0) ? Cp : Cn;
+        return (W != NULL) ? C * W[i] : C;
     }
 
     void update_alpha_status(int i) {
@@ -459,6 +731,8 @@ protected:
     }
     void swap_index(int i, int j);
     void reconstruct_gradient();
+    void reset_partial();
+    int thread_num() const;
     virtual int select_working_set(int &i, int &j);
     virtual double calculate_rho();
     virtual void do_shrinking();
@@ -472,11 +746,34 @@ void Solver::swap_index(int i, int j) {
     swap(G[i], G[j]);
     swap(alpha_status[i], alpha_status[j]);
     swap(alpha[i], alpha[j]);
+    if (W != NULL)
+        swap(W[i], W[j]);
     swap(p[i], p[j]);
     swap(active_set[i], active_set[j]);
     swap(G_bar[i], G_bar[j]);
 }
 
+void Solver::reset_partial() {
+    for (int t = 0; t < threads; t++) {
+        partial[t].max[0] = partial[t].max[1] = -INF;
+        partial[t].max_idx[0] = partial[t].max_idx[1] = -1;
+        partial[t].min = INF;
+        partial[t].min_idx = -1;
+    }
+}
+
+int Solver::thread_num() const {
+#if defined _OPENMP_MY
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+// Loops over elements are split by OpenMP static schedule, so thread t gets
+// t-th contiguous part. Partial results merged in thread order with the same
+// comparisons as serial loop give the same indices as serial solver.
+
 void Solver::reconstruct_gradient() {
     // reconstruct inactive elements of G from G_bar and free variables
 
@@ -485,9 +782,15 @@ void Solver::reconstruct_gradient() {
     int i, j;
     int nr_free = 0;
 
+#if defined _OPENMP_MY
+#pragma omp parallel for private(j) if (l - active_size >= SOLVER_PARALLEL_MIN)
+#endif
     for (j = active_size; j < l; j++)
         G[j] = G_bar[j] + p[j];
 
+#if defined _OPENMP_MY
+#pragma omp parallel for private(j) reduction(+:nr_free) if (active_size >= SOLVER_PARALLEL_MIN)
+#endif
     for (j = 0; j < active_size; j++)
         if (is_free(j))
             nr_free++;
@@ -495,6 +798,7 @@ void Solver::reconstruct_gradient() {
     if (2 * nr_free < active_size)
         info("\nWARNING: using -h 0 may be faster\n");
 
+    // sums over j stay serial, other order would change G
     if (nr_free * l > 2 * active_size * (l - active_size)) {
         for (i = active_size; i < l; i++) {
             const Qfloat *Q_i = Q->get_Q(i, active_size);
@@ -507,6 +811,9 @@ void Solver::reconstruct_gradient() {
             if (is_free(i)) {
                 const Qfloat *Q_i = Q->get_Q(i, l);
                 double alpha_i = alpha[i];
+#if defined _OPENMP_MY
+#pragma omp parallel for private(j) if (l - active_size >= SOLVER_PARALLEL_MIN)
+#endif
                 for (j = active_size; j < l; j++)
                     G[j] += alpha_i * Q_i[j];
             }
@@ -515,7 +822,7 @@ void Solver::reconstruct_gradient() {
 
 void Solver::Solve(int l, QMatrix& Q, const double *p_, const schar *y_,
         double *alpha_, double Cp, double Cn, double eps,
-        SolutionInfo* si, int shrinking) {
+        SolutionInfo* si, int shrinking, const double *W_) {
     this->l = l;
     this->Q = &Q;
     QD = Q.get_QD();
@@ -524,8 +831,19 @@ void Solver::Solve(int l, QMatrix& Q, const double *p_, const schar *y_,
     clone(alpha, alpha_, l);
     this->Cp = Cp;
     this->Cn = Cn;
+    W = NULL;
+    if (W_ != NULL)
+        clone(W, W_, l);
     this->eps = eps;
     unshrink = false;
+#if defined _OPENMP_MY
+    threads = omp_get_max_threads();
+#else
+    threads = 1;
+#endif
+    partial = new Partial[threads];
+    shrink = new char[l];
+    Timer timer;
 
     // initialize alpha_status
     {
@@ -555,12 +873,17 @@ void Solver::Solve(int l, QMatrix& Q, const double *p_, const schar *y_,
             if (!is_lower_bound(i)) {
                 const Qfloat *Q_i = Q.get_Q(i, l);
                 double alpha_i = alpha[i];
+                double C_i = get_C(i);
+                bool upper = is_upper_bound(i);
                 int j;
-                for (j = 0; j < l; j++)
+#if defined _OPENMP_MY
+#pragma omp parallel for private(j) if (l >= SOLVER_PARALLEL_MIN)
+#endif
+                for (j = 0; j < l; j++) {
                     G[j] += alpha_i * Q_i[j];
-                if (is_upper_bound(i))
-                    for (j = 0; j < l; j++)
-                        G_bar[j] += get_C(i) * Q_i[j];
+                    if (upper)
+                        G_bar[j] += C_i * Q_i[j];
+                }
             }
     }
 
@@ -674,8 +997,10 @@ void Solver::Solve(int l, QMatrix& Q, const double *p_, const schar *y_,
         double delta_alpha_i = alpha[i] - old_alpha_i;
         double delta_alpha_j = alpha[j] - old_alpha_j;
 
-        //TODO parallelize with OMP
         int k;
+#if defined _OPENMP_MY
+#pragma omp parallel for private(k) if (active_size >= SOLVER_PARALLEL_MIN)
+#endif
         for (k = 0; k < active_size; k++) {
             G[k] += Q_i[k] * delta_alpha_i + Q_j[k] * delta_alpha_j;
         }
@@ -690,22 +1015,22 @@ void Solver::Solve(int l, QMatrix& Q, const double *p_, const schar *y_,
             int k;
             if (ui != is_upper_bound(i)) {
                 Q_i = Q.get_Q(i, l);
-                if (ui)                    
-                    for (k = 0; k < l; k++)
-                        G_bar[k] -= C_i * Q_i[k];
-                else
-                    for (k = 0; k < l; k++)
-                        G_bar[k] += C_i * Q_i[k];
+                double C = ui ? -C_i : C_i;
+#if defined _OPENMP_MY
+#pragma omp parallel for private(k) if (l >= SOLVER_PARALLEL_MIN)
+#endif
+                for (k = 0; k < l; k++)
+                    G_bar[k] += C * Q_i[k];
             }
 
             if (uj != is_upper_bound(j)) {
                 Q_j = Q.get_Q(j, l);
-                if (uj)
-                    for (k = 0; k < l; k++)
-                        G_bar[k] -= C_j * Q_j[k];
-                else                  
-                    for (k = 0; k < l; k++)
-                        G_bar[k] += C_j * Q_j[k];
+                double C = uj ? -C_j : C_j;
+#if defined _OPENMP_MY
+#pragma omp parallel for private(k) if (l >= SOLVER_PARALLEL_MIN)
+#endif
+                for (k = 0; k < l; k++)
+                    G_bar[k] += C * Q_j[k];
             }
         }
     }
@@ -752,7 +1077,9 @@ void Solver::Solve(int l, QMatrix& Q, const double *p_, const schar *y_,
     si->upper_bound_p = Cp;
     si->upper_bound_n = Cn;
 
-    info("\noptimization finished, #iter = %d\n", iter);
+    int64_t duration = timer.sinceStart();
+    info("\noptimization finished, #iter = %d, %.3f ms per iteration\n", iter,
+            (iter > 0) ? (double) duration / iter : 0.0);
 
     delete[] p;
     delete[] y;
@@ -761,6 +1088,9 @@ void Solver::Solve(int l, QMatrix& Q, const double *p_, const schar *y_,
     delete[] active_set;
     delete[] G;
     delete[] G_bar;
+    delete[] W;
+    delete[] partial;
+    delete[] shrink;
 }
 
 // return 1 if already optimal, return 0 otherwise
@@ -777,93 +1107,109 @@ int Solver::select_working_set(int &out_i, int &out_j) {
     int Gmax_idx = -1;
     int Gmin_idx = -1;
     double obj_diff_min = INF;
+    int t;
 
-    for (int t = 0; t < active_size; t++)
-        if (y[t] == +1) {
-            if (!is_upper_bound(t))
-                if (-G[t] >= Gmax) {
-                    Gmax = -G[t];
-                    Gmax_idx = t;
-                }
-        } else {
-            if (!is_lower_bound(t))
-                if (G[t] >= Gmax) {
-                    Gmax = G[t];
-                    Gmax_idx = t;
-                }
+    reset_partial();
+#if defined _OPENMP_MY
+#pragma omp parallel private(t) if (active_size >= SOLVER_PARALLEL_MIN)
+#endif
+    {
+        Partial& part = partial[thread_num()];
+#if defined _OPENMP_MY
+#pragma omp for schedule(static)
+#endif
+        for (t = 0; t < active_size; t++)
+            if (y[t] == +1) {
+                if (!is_upper_bound(t))
+                    if (-G[t] >= part.max[0]) {
+                        part.max[0] = -G[t];
+                        part.max_idx[0] = t;
+                    }
+            } else {
+                if (!is_lower_bound(t))
+                    if (G[t] >= part.max[0]) {
+                        part.max[0] = G[t];
+                        part.max_idx[0] = t;
+                    }
+            }
+    }
+    for (t = 0; t < threads; t++)
+        if (partial[t].max_idx[0] != -1 && partial[t].max[0] >= Gmax) {
+            Gmax = partial[t].max[0];
+            Gmax_idx = partial[t].max_idx[0];
         }
 
     int i = Gmax_idx;
     const Qfloat *Q_i = NULL;
     if (i != -1) // NULL Q_i not accessed: Gmax=-INF if i=-1
         Q_i = Q->get_Q(i, active_size);
-    
-    double* grad_diff = new double[active_size];
-    double* obj_diff = new double[active_size];
-    
+
 //#ifdef _OPENCL    
 //    OpenclTools* oclt = OpenclTools::getInstancePtr();
 //    oclt->selectWorkingSet(active_size, i, (const char*)y, alpha_status, l, grad_diff, Gmax, G, QD, Q_i, obj_diff);
 //    oclt->cleanWorkPart();
 //#else
-    //TODO parallelize with OMP
     int j;
-    for (j = 0; j < active_size; j++) {
-        if (y[j] == +1) {
-            if (!is_lower_bound(j)) {
-                grad_diff[j] = Gmax + G[j];                
-                if (grad_diff[j] > 0) {                    
-                    double quad_coef = QD[i] + QD[j] - 2.0 * y[i] * Q_i[j];
-                    if (quad_coef > 0)
-                        obj_diff[j] = -(grad_diff[j] * grad_diff[j]) / quad_coef;
-                    else
-                        obj_diff[j] = -(grad_diff[j] * grad_diff[j]) / TAU;                    
+    reset_partial();
+#if defined _OPENMP_MY
+#pragma omp parallel private(j) if (active_size >= SOLVER_PARALLEL_MIN)
+#endif
+    {
+        Partial& part = partial[thread_num()];
+#if defined _OPENMP_MY
+#pragma omp for schedule(static)
+#endif
+        for (j = 0; j < active_size; j++) {
+            if (y[j] == +1) {
+                if (!is_lower_bound(j)) {
+                    double grad_diff = Gmax + G[j];
+                    if (G[j] >= part.max[1])
+                        part.max[1] = G[j];
+                    if (grad_diff > 0) {
+                        double obj_diff;
+                        double quad_coef = QD[i] + QD[j] - 2.0 * y[i] * Q_i[j];
+                        if (quad_coef > 0)
+                            obj_diff = -(grad_diff * grad_diff) / quad_coef;
+                        else
+                            obj_diff = -(grad_diff * grad_diff) / TAU;
+
+                        if (obj_diff <= part.min) {
+                            part.min_idx = j;
+                            part.min = obj_diff;
+                        }
+                    }
                 }
-            }
-        } else {
-            if (!is_upper_bound(j)) {
-                grad_diff[j] = Gmax - G[j];                
-                if (grad_diff[j] > 0) {                    
-                    double quad_coef = QD[i] + QD[j] + 2.0 * y[i] * Q_i[j];
-                    if (quad_coef > 0)
-                        obj_diff[j] = -(grad_diff[j] * grad_diff[j]) / quad_coef;
-                    else
-                        obj_diff[j] = -(grad_diff[j] * grad_diff[j]) / TAU;                    
+            } else {
+                if (!is_upper_bound(j)) {
+                    double grad_diff = Gmax - G[j];
+                    if (-G[j] >= part.max[1])
+                        part.max[1] = -G[j];
+                    if (grad_diff > 0) {
+                        double obj_diff;
+                        double quad_coef = QD[i] + QD[j] + 2.0 * y[i] * Q_i[j];
+                        if (quad_coef > 0)
+                            obj_diff = -(grad_diff * grad_diff) / quad_coef;
+                        else
+                            obj_diff = -(grad_diff * grad_diff) / TAU;
+
+                        if (obj_diff <= part.min) {
+                            part.min_idx = j;
+                            part.min = obj_diff;
+                        }
+                    }
                 }
             }
         }
     }
 //#endif
-    
-    for (int j = 0; j < active_size; j++) {
-        if (y[j] == +1) {
-            if (!is_lower_bound(j)) {
-                if (G[j] >= Gmax2)
-                    Gmax2 = G[j];
-                if (grad_diff[j] > 0) {
-                    if (obj_diff[j] <= obj_diff_min) {
-                        Gmin_idx = j;
-                        obj_diff_min = obj_diff[j];
-                    }
-                }
-            }
-        }
-        else{
-            if (!is_upper_bound(j)) {
-                if (-G[j] >= Gmax2)
-                    Gmax2 = -G[j];
-                if (grad_diff[j] > 0) {
-                    if (obj_diff[j] <= obj_diff_min) {
-                        Gmin_idx = j;
-                        obj_diff_min = obj_diff[j];
-                    }
-                }
-            }
+    for (t = 0; t < threads; t++) {
+        if (partial[t].max[1] >= Gmax2)
+            Gmax2 = partial[t].max[1];
+        if (partial[t].min_idx != -1 && partial[t].min <= obj_diff_min) {
+            Gmin_idx = partial[t].min_idx;
+            obj_diff_min = partial[t].min;
         }
     }
-    
-    delete[] grad_diff;
-    delete[] obj_diff;
 
     if (Gmax + Gmax2 < eps)
         return 1;
@@ -894,6 +1240,9 @@ void Solver::do_shrinking() {
     double Gmax2 = -INF; // max { y_i * grad(f)_i | i in I_low(\alpha) }
 
     // find maximal violating pair first
+#if defined _OPENMP_MY
+#pragma omp parallel for private(i) reduction(max:Gmax1, Gmax2) if (active_size >= SOLVER_PARALLEL_MIN)
+#endif
     for (i = 0; i < active_size; i++) {
         if (y[i] == +1) {
             if (!is_upper_bound(i)) {
@@ -923,11 +1272,18 @@ void Solver::do_shrinking() {
         info("*");
     }
 
+    // elements are tested before they are moved, so tests can be done first
+#if defined _OPENMP_MY
+#pragma omp parallel for private(i) if (active_size >= SOLVER_PARALLEL_MIN)
+#endif
     for (i = 0; i < active_size; i++)
-        if (be_shrunk(i, Gmax1, Gmax2)) {
+        shrink[i] = be_shrunk(i, Gmax1, Gmax2);
+
+    for (i = 0; i < active_size; i++)
+        if (shrink[i]) {
             active_size--;
             while (active_size > i) {
-                if (!be_shrunk(active_size, Gmax1, Gmax2)) {
+                if (!shrink[active_size]) {
                     swap_index(i, active_size);
                     break;
                 }
@@ -1012,21 +1368,42 @@ int Solver_NU::select_working_set(int &out_i, int &out_j) {
 
     int Gmin_idx = -1;
     double obj_diff_min = INF;
+    int t;
 
-    for (int t = 0; t < active_size; t++)
-        if (y[t] == +1) {
-            if (!is_upper_bound(t))
-                if (-G[t] >= Gmaxp) {
-                    Gmaxp = -G[t];
-                    Gmaxp_idx = t;
-                }
-        } else {
-            if (!is_lower_bound(t))
-                if (G[t] >= Gmaxn) {
-                    Gmaxn = G[t];
-                    Gmaxn_idx = t;
-                }
+    reset_partial();
+#if defined _OPENMP_MY
+#pragma omp parallel private(t) if (active_size >= SOLVER_PARALLEL_MIN)
+#endif
+    {
+        Partial& part = partial[thread_num()];
+#if defined _OPENMP_MY
+#pragma omp for schedule(static)
+#endif
+        for (t = 0; t < active_size; t++)
+            if (y[t] == +1) {
+                if (!is_upper_bound(t))
+                    if (-G[t] >= part.max[0]) {
+                        part.max[0] = -G[t];
+                        part.max_idx[0] = t;
+                    }
+            } else {
+                if (!is_lower_bound(t))
+                    if (G[t] >= part.max[1]) {
+                        part.max[1] = G[t];
+                        part.max_idx[1] = t;
+                    }
+            }
+    }
+    for (t = 0; t < threads; t++) {
+        if (partial[t].max_idx[0] != -1 && partial[t].max[0] >= Gmaxp) {
+            Gmaxp = partial[t].max[0];
+            Gmaxp_idx = partial[t].max_idx[0];
+        }
+        if (partial[t].max_idx[1] != -1 && partial[t].max[1] >= Gmaxn) {
+            Gmaxn = partial[t].max[1];
+            Gmaxn_idx = partial[t].max_idx[1];
         }
+    }
 
     int ip = Gmaxp_idx;
     int in = Gmaxn_idx;
@@ -1036,49 +1413,69 @@ int Solver_NU::select_working_set(int &out_i, int &out_j) {
         Q_ip = Q->get_Q(ip, active_size);
     if (in != -1)
         Q_in = Q->get_Q(in, active_size);
-    
-    //TODO make changes and parallelize with OMP
-    for (int j = 0; j < active_size; j++) {
-        if (y[j] == +1) {
-            if (!is_lower_bound(j)) {
-                double grad_diff = Gmaxp + G[j];
-                if (G[j] >= Gmaxp2)
-                    Gmaxp2 = G[j];
-                if (grad_diff > 0) {
-                    double obj_diff;
-                    double quad_coef = QD[ip] + QD[j] - 2 * Q_ip[j];
-                    if (quad_coef > 0)
-                        obj_diff = -(grad_diff * grad_diff) / quad_coef;
-                    else
-                        obj_diff = -(grad_diff * grad_diff) / TAU;
-
-                    if (obj_diff <= obj_diff_min) {
-                        Gmin_idx = j;
-                        obj_diff_min = obj_diff;
+
+    int j;
+    reset_partial();
+#if defined _OPENMP_MY
+#pragma omp parallel private(j) if (active_size >= SOLVER_PARALLEL_MIN)
+#endif
+    {
+        Partial& part = partial[thread_num()];
+#if defined _OPENMP_MY
+#pragma omp for schedule(static)
+#endif
+        for (j = 0; j < active_size; j++) {
+            if (y[j] == +1) {
+                if (!is_lower_bound(j)) {
+                    double grad_diff = Gmaxp + G[j];
+                    if (G[j] >= part.max[0])
+                        part.max[0] = G[j];
+                    if (grad_diff > 0) {
+                        double obj_diff;
+                        double quad_coef = QD[ip] + QD[j] - 2 * Q_ip[j];
+                        if (quad_coef > 0)
+                            obj_diff = -(grad_diff * grad_diff) / quad_coef;
+                        else
+                            obj_diff = -(grad_diff * grad_diff) / TAU;
+
+                        if (obj_diff <= part.min) {
+                            part.min_idx = j;
+                            part.min = obj_diff;
+                        }
                     }
                 }
-            }
-        } else {
-            if (!is_upper_bound(j)) {
-                double grad_diff = Gmaxn - G[j];
-                if (-G[j] >= Gmaxn2)
-                    Gmaxn2 = -G[j];
-                if (grad_diff > 0) {
-                    double obj_diff;
-                    double quad_coef = QD[in] + QD[j] - 2 * Q_in[j];
-                    if (quad_coef > 0)
-                        obj_diff = -(grad_diff * grad_diff) / quad_coef;
-                    else
-                        obj_diff = -(grad_diff * grad_diff) / TAU;
-
-                    if (obj_diff <= obj_diff_min) {
-                        Gmin_idx = j;
-                        obj_diff_min = obj_diff;
+            } else {
+                if (!is_upper_bound(j)) {
+                    double grad_diff = Gmaxn - G[j];
+                    if (-G[j] >= part.max[1])
+                        part.max[1] = -G[j];
+                    if (grad_diff > 0) {
+                        double obj_diff;
+                        double quad_coef = QD[in] + QD[j] - 2 * Q_in[j];
+                        if (quad_coef > 0)
+                            obj_diff = -(grad_diff * grad_diff) / quad_coef;
+                        else
+                            obj_diff = -(grad_diff * grad_diff) / TAU;
+
+                        if (obj_diff <= part.min) {
+                            part.min_idx = j;
+                            part.min = obj_diff;
+                        }
                     }
                 }
             }
         }
     }
+    for (t = 0; t < threads; t++) {
+        if (partial[t].max[0] >= Gmaxp2)
+            Gmaxp2 = partial[t].max[0];
+        if (partial[t].max[1] >= Gmaxn2)
+            Gmaxn2 = partial[t].max[1];
+        if (partial[t].min_idx != -1 && partial[t].min <= obj_diff_min) {
+            Gmin_idx = partial[t].min_idx;
+            obj_diff_min = partial[t].min;
+        }
+    }
 
     if (max(Gmaxp + Gmaxp2, Gmaxn + Gmaxn2) < eps)
         return 1;
@@ -1115,6 +1512,9 @@ void Solver_NU::do_shrinking() {
 
     // find maximal violating pair first
     int i;
+#if defined _OPENMP_MY
+#pragma omp parallel for private(i) reduction(max:Gmax1, Gmax2, Gmax3, Gmax4) if (active_size >= SOLVER_PARALLEL_MIN)
+#endif
     for (i = 0; i < active_size; i++) {
         if (!is_upper_bound(i)) {
             if (y[i] == +1) {
@@ -1134,11 +1534,17 @@ void Solver_NU::do_shrinking() {
         active_size = l;
     }
 
+#if defined _OPENMP_MY
+#pragma omp parallel for private(i) if (active_size >= SOLVER_PARALLEL_MIN)
+#endif
     for (i = 0; i < active_size; i++)
-        if (be_shrunk(i, Gmax1, Gmax2, Gmax3, Gmax4)) {
+        shrink[i] = be_shrunk(i, Gmax1, Gmax2, Gmax3, Gmax4);
+
+    for (i = 0; i < active_size; i++)
+        if (shrink[i]) {
             active_size--;
             while (active_size > i) {
-                if (!be_shrunk(active_size, Gmax1, Gmax2, Gmax3, Gmax4)) {
+                if (!shrink[active_size]) {
                     swap_index(i, active_size);
                     break;
                 }
@@ -1198,7 +1604,7 @@ class SVC_Q : public Kernel {
 public:
 
     SVC_Q(const svm_problem& prob, const svm_parameter& param, const schar *y_)
-    : Kernel(prob.l, prob.x, param) {
+    : Kernel(prob.l, prob.x, prob.source, param) {
         clone(y, y_, prob.l);
         cache = new Cache(prob.l, (long int) (param.cache_size * (1 << 20)));
         QD = new double[prob.l];
@@ -1215,6 +1621,10 @@ public:
         int start;
         if ((start = cache->get_data(i, &data, len)) < len) {
 #ifndef _OPENCL         
+            if (dense) {
+                dense_column(i, start, len, y, data);
+                return data;
+            }
             int j;
 #pragma omp parallel for private(j)            
             for (j = start; j < len; j++)
@@ -1255,7 +1665,7 @@ class ONE_CLASS_Q : public Kernel {
 public:
 
     ONE_CLASS_Q(const svm_problem& prob, const svm_parameter& param)
-    : Kernel(prob.l, prob.x, param) {
+    : Kernel(prob.l, prob.x, prob.source, param) {
         cache = new Cache(prob.l, (long int) (param.cache_size * (1 << 20)));
         QD = new double[prob.l];
         int i;
@@ -1270,6 +1680,10 @@ public:
         Qfloat *data;
         int start, j;
         if ((start = cache->get_data(i, &data, len)) < len) {
+            if (dense) {
+                dense_column(i, start, len, 0, data);
+                return data;
+            }
 #ifdef _OPENMP_MY             
 #pragma omp parallel for private(j)
 #endif
@@ -1303,7 +1717,7 @@ class SVR_Q : public Kernel {
 public:
 
     SVR_Q(const svm_problem& prob, const svm_parameter& param)
-    : Kernel(prob.l, prob.x, param) {
+    : Kernel(prob.l, prob.x, prob.source, param) {
         l = prob.l;
         cache = new Cache(l, (long int) (param.cache_size * (1 << 20)));
         QD = new double[2 * l];
@@ -1337,9 +1751,13 @@ public:
         int j, real_i = index[i];
         if (cache->get_data(real_i, &data, l) < l) {
 #ifndef _OPENCL
+            if (dense)
+                dense_column(real_i, 0, l, 0, data);
+            else {
 #pragma omp parallel for private(j)
-            for (j = 0; j < l; j++)
-                data[j] = (Qfloat) (this->*kernel_function)(real_i, j);        
+                for (j = 0; j < l; j++)
+                    data[j] = (Qfloat) (this->*kernel_function)(real_i, j);
+            }
 #else            
             OpenCLToolsTrain* oclt = OpenCLToolsTrain::getInstancePtr();
             oclt->get_Q(data, l, 0, l, real_i, kernel_type, 0, 0, x, 
@@ -1384,7 +1802,8 @@ private:
 
 static void solve_c_svc(
         const svm_problem *prob, const svm_parameter* param,
-        double *alpha, Solver::SolutionInfo* si, double Cp, double Cn) {
+        double *alpha, Solver::SolutionInfo* si, double Cp, double Cn,
+        const double *init_alpha = NULL) {
     int l = prob->l;
     double *minus_ones = new double[l];
     schar *y = new schar[l];
@@ -1396,18 +1815,23 @@ static void solve_c_svc(
         minus_ones[i] = -1;
         if (prob->y[i] > 0) y[i] = +1;
         else y[i] = -1;
+        // warm start, alpha is kept inside bounds of this C
+        if (init_alpha != NULL) {
+            double C = ((y[i] > 0) ? Cp : Cn) * ((prob->W != NULL) ? prob->W[i] : 1);
+            alpha[i] = min(fabs(init_alpha[i]), C);
+        }
     }
 
     Solver s;
     SVC_Q svc(*prob, *param, y);
     s.Solve(l, svc, minus_ones, y,
-            alpha, Cp, Cn, param->eps, si, param->shrinking);
+            alpha, Cp, Cn, param->eps, si, param->shrinking, prob->W);
 
     double sum_alpha = 0;
     for (i = 0; i < l; i++)
         sum_alpha += alpha[i];
 
-    if (Cp == Cn)
+    if (Cp == Cn && prob->W == NULL)
         info("nu = %f\n", sum_alpha / (Cp * prob->l));
 
     for (i = 0; i < l; i++)
@@ -1519,10 +1943,20 @@ static void solve_epsilon_svr(
         y[i + l] = -1;
     }
 
+    double *W2 = NULL;
+    if (prob->W != NULL) {
+        W2 = new double[2 * l];
+        for (i = 0; i < l; i++) {
+            W2[i] = prob->W[i];
+            W2[i + l] = prob->W[i];
+        }
+    }
+
     Solver s;
     SVR_Q svr(*prob, *param);
     s.Solve(2 * l, svr, linear_term, y,
-            alpha2, param->C, param->C, param->eps, si, param->shrinking);
+            alpha2, param->C, param->C, param->eps, si, param->shrinking, W2);
+    delete[] W2;
 
     double sum_alpha = 0;
     for (i = 0; i < l; i++) {
@@ -1584,12 +2018,12 @@ struct decision_function {
 
 static decision_function svm_train_one(
         const svm_problem *prob, const svm_parameter *param,
-        double Cp, double Cn) {
+        double Cp, double Cn, const double *init_alpha = NULL) {
     double *alpha = Malloc(double, prob->l);
     Solver::SolutionInfo si;
     switch (param->svm_type) {
         case C_SVC:
-            solve_c_svc(prob, param, alpha, &si, Cp, Cn);
+            solve_c_svc(prob, param, alpha, &si, Cp, Cn, init_alpha);
             break;
         case NU_SVC:
             solve_nu_svc(prob, param, alpha, &si);
@@ -1614,11 +2048,12 @@ static decision_function svm_train_one(
     for (int i = 0; i < prob->l; i++) {
         if (fabs(alpha[i]) > 0) {
             ++nSV;
+            double weight = (prob->W != NULL) ? prob->W[i] : 1;
             if (prob->y[i] > 0) {
-                if (fabs(alpha[i]) >= si.upper_bound_p)
+                if (fabs(alpha[i]) >= si.upper_bound_p * weight)
                     ++nBSV;
             } else {
-                if (fabs(alpha[i]) >= si.upper_bound_n)
+                if (fabs(alpha[i]) >= si.upper_bound_n * weight)
                     ++nBSV;
             }
         }
@@ -1814,6 +2249,7 @@ static void svm_binary_svc_probability(
     int nr_fold = 5;
     int *perm = Malloc(int, prob->l);
     double *dec_values = Malloc(double, prob->l);
+    svm_node *row = (prob->source != NULL) ? Malloc(svm_node, prob->source->dim + 1) : NULL;
 
     // random shuffle
     for (i = 0; i < prob->l; i++) perm[i] = i;
@@ -1830,16 +2266,22 @@ static void svm_binary_svc_probability(
         subprob.l = prob->l - (end - begin);
         subprob.x = Malloc(struct svm_node*, subprob.l);
         subprob.y = Malloc(double, subprob.l);
+        subprob.W = (prob->W != NULL) ? Malloc(double, subprob.l) : NULL;
+        subprob.source = prob->source;
 
         k = 0;
         for (j = 0; j < begin; j++) {
             subprob.x[k] = prob->x[perm[j]];
             subprob.y[k] = prob->y[perm[j]];
+            if (subprob.W != NULL)
+                subprob.W[k] = prob->W[perm[j]];
             ++k;
         }
         for (j = end; j < prob->l; j++) {
             subprob.x[k] = prob->x[perm[j]];
             subprob.y[k] = prob->y[perm[j]];
+            if (subprob.W != NULL)
+                subprob.W[k] = prob->W[perm[j]];
             ++k;
         }
         int p_count = 0, n_count = 0;
@@ -1871,7 +2313,7 @@ static void svm_binary_svc_probability(
             subparam.weight[1] = Cn;
             struct svm_model *submodel = svm_train(&subprob, &subparam);
             for (j = begin; j < end; j++) {
-                svm_predict_values(submodel, prob->x[perm[j]], &(dec_values[perm[j]]));
+                svm_predict_values(submodel, svm_problem_row(prob, perm[j], row), &(dec_values[perm[j]]));
                 // ensure +1 -1 order; reason not using CV subroutine
                 dec_values[perm[j]] *= submodel->label[0];
             }
@@ -1880,10 +2322,12 @@ static void svm_binary_svc_probability(
         }
         free(subprob.x);
         free(subprob.y);
+        free(subprob.W);
     }
     sigmoid_train(prob->l, dec_values, prob->y, probA, probB);
     free(dec_values);
     free(perm);
+    free(row);
 }
 
 // Return parameter of a Laplace distribution 
@@ -1992,6 +2436,18 @@ static void svm_group_classes(const svm_problem *prob, int *nr_class_ret, int **
 //
 
 svm_model *svm_train(const svm_problem *prob, const svm_parameter *param) {
+    return svm_train_warm_start(prob, param, NULL, NULL);
+}
+
+svm_model *svm_train_warm_start(const svm_problem *prob, const svm_parameter *param,
+        const double *init_alpha, double *alpha) {
+    bool quiet = svm_quiet;
+    svm_quiet = quiet || param->quiet;
+    // warm start is done only for two class C-SVC
+    bool warm = param->svm_type == C_SVC;
+    if (alpha != NULL)
+        for (int i = 0; i < prob->l; i++)
+            alpha[i] = 0;
     svm_model *model = Malloc(svm_model, 1);
     model->param = *param;
     model->free_sv = 0; // XXX
@@ -2049,11 +2505,16 @@ svm_model *svm_train(const svm_problem *prob, const svm_parameter *param) {
         svm_group_classes(prob, &nr_class, &label, &start, &count, perm);
         if (nr_class == 1)
             info("WARNING: training data in only one class. See README for details.\n");
+        warm = warm && nr_class == 2;
 
         svm_node **x = Malloc(svm_node *, l);
+        double *W = (prob->W != NULL) ? Malloc(double, l) : NULL;
         int i;
-        for (i = 0; i < l; i++)
+        for (i = 0; i < l; i++) {
             x[i] = prob->x[perm[i]];
+            if (W != NULL)
+                W[i] = prob->W[perm[i]];
+        }
 
         // calculate weighted C
 
@@ -2093,20 +2554,41 @@ svm_model *svm_train(const svm_problem *prob, const svm_parameter *param) {
                 sub_prob.l = ci + cj;
                 sub_prob.x = Malloc(svm_node *, sub_prob.l);
                 sub_prob.y = Malloc(double, sub_prob.l);
+                sub_prob.W = (W != NULL) ? Malloc(double, sub_prob.l) : NULL;
+                sub_prob.source = prob->source;
                 int k;
                 for (k = 0; k < ci; k++) {
                     sub_prob.x[k] = x[si + k];
                     sub_prob.y[k] = +1;
+                    if (W != NULL)
+                        sub_prob.W[k] = W[si + k];
                 }
                 for (k = 0; k < cj; k++) {
                     sub_prob.x[ci + k] = x[sj + k];
                     sub_prob.y[ci + k] = -1;
+                    if (W != NULL)
+                        sub_prob.W[ci + k] = W[sj + k];
                 }
 
                 if (param->probability)
                     svm_binary_svc_probability(&sub_prob, param, weighted_C[i], weighted_C[j], probA[p], probB[p]);
 
-                f[p] = svm_train_one(&sub_prob, param, weighted_C[i], weighted_C[j]);
+                double *sub_init = NULL;
+                if (warm && init_alpha != NULL) {
+                    sub_init = Malloc(double, sub_prob.l);
+                    for (k = 0; k < ci; k++)
+                        sub_init[k] = init_alpha[perm[si + k]];
+                    for (k = 0; k < cj; k++)
+                        sub_init[ci + k] = init_alpha[perm[sj + k]];
+                }
+                f[p] = svm_train_one(&sub_prob, param, weighted_C[i], weighted_C[j], sub_init);
+                free(sub_init);
+                if (warm && alpha != NULL) {
+                    for (k = 0; k < ci; k++)
+                        alpha[perm[si + k]] = f[p].alpha[k];
+                    for (k = 0; k < cj; k++)
+                        alpha[perm[sj + k]] = f[p].alpha[ci + k];
+                }
                 for (k = 0; k < ci; k++)
                     if (!nonzero[si + k] && fabs(f[p].alpha[k]) > 0)
                         nonzero[si + k] = true;
@@ -2115,6 +2597,7 @@ svm_model *svm_train(const svm_problem *prob, const svm_parameter *param) {
                         nonzero[sj + k] = true;
                 free(sub_prob.x);
                 free(sub_prob.y);
+                free(sub_prob.W);
                 ++p;
             }
 
@@ -2208,6 +2691,7 @@ svm_model *svm_train(const svm_problem *prob, const svm_parameter *param) {
         free(perm);
         free(start);
         free(x);
+        free(W);
         free(weighted_C);
         free(nonzero);
         for (i = 0; i < nr_class * (nr_class - 1) / 2; i++)
@@ -2216,9 +2700,24 @@ svm_model *svm_train(const svm_problem *prob, const svm_parameter *param) {
         free(nz_count);
         free(nz_start);
     }
+    // support vectors of problem with row source are copied out of it, model does not keep source
+    if (prob->source != NULL && model->l > 0) {
+        int width = prob->source->dim + 1;
+        svm_node *sv_space = Malloc(svm_node, (size_t) model->l * width);
+        for (int i = 0; i < model->l; i++)
+            model->SV[i] = source_row(prob->source, (int) model->SV[i]->value, &sv_space[(size_t) i * width]);
+        model->free_sv = 1;
+    }
+    svm_quiet = quiet;
     return model;
 }
 
+const svm_node *svm_problem_row(const svm_problem *prob, int i, svm_node *buffer) {
+    if (prob->source == NULL)
+        return prob->x[i];
+    return source_row(prob->source, (int) prob->x[i]->value, buffer);
+}
+
 // Stratified cross validation
 
 void svm_cross_validation(const svm_problem *prob, const svm_parameter *param, int nr_fold, double *target) {
@@ -2287,41 +2786,80 @@ void svm_cross_validation(const svm_problem *prob, const svm_parameter *param, i
             fold_start[i] = i * l / nr_fold;
     }
 
+    // folds are trained at once, remaining threads are divided between folds
+    // for kernel and solver loops, each fold gets part of kernel cache.
+    // Kernel matrices are allocated through locked MemTracker in _DEBUG builds
+    int concurrent = 1;
+    int inner = 1;
+    //OpenCL kernel evaluation goes through one shared device context, there folds stay sequential
+#if defined _OPENMP_MY && !defined _OPENCL
+    int threads = omp_get_max_threads();
+    concurrent = (param->fold_threads > 0) ? param->fold_threads : nr_fold;
+    concurrent = max(1, min(concurrent, min(nr_fold, threads)));
+    // probability estimates use shared rand()
+    if (param->probability)
+        concurrent = 1;
+    inner = max(1, threads / concurrent);
+    int levels = omp_get_max_active_levels();
+    if (concurrent > 1 && inner > 1 && levels < 2)
+        omp_set_max_active_levels(2);
+#endif
+    struct svm_parameter fold_param = *param;
+    fold_param.cache_size = param->cache_size / concurrent;
+
+#if defined _OPENMP_MY && !defined _OPENCL
+#pragma omp parallel for private(i) num_threads(concurrent) schedule(dynamic, 1)
+#endif
     for (i = 0; i < nr_fold; i++) {
         int begin = fold_start[i];
         int end = fold_start[i + 1];
         int j, k;
         struct svm_problem subprob;
+#if defined _OPENMP_MY && !defined _OPENCL
+        omp_set_num_threads(inner);
+#endif
 
         subprob.l = l - (end - begin);
         subprob.x = Malloc(struct svm_node*, subprob.l);
         subprob.y = Malloc(double, subprob.l);
+        subprob.W = (prob->W != NULL) ? Malloc(double, subprob.l) : NULL;
+        subprob.source = prob->source;
+        svm_node *row = (prob->source != NULL) ? Malloc(svm_node, prob->source->dim + 1) : NULL;
 
         k = 0;
         for (j = 0; j < begin; j++) {
             subprob.x[k] = prob->x[perm[j]];
             subprob.y[k] = prob->y[perm[j]];
+            if (subprob.W != NULL)
+                subprob.W[k] = prob->W[perm[j]];
             ++k;
         }
         for (j = end; j < l; j++) {
             subprob.x[k] = prob->x[perm[j]];
             subprob.y[k] = prob->y[perm[j]];
+            if (subprob.W != NULL)
+                subprob.W[k] = prob->W[perm[j]];
             ++k;
         }
-        struct svm_model *submodel = svm_train(&subprob, param);
+        struct svm_model *submodel = svm_train(&subprob, &fold_param);
         if (param->probability &&
                 (param->svm_type == C_SVC || param->svm_type == NU_SVC)) {
             double *prob_estimates = Malloc(double, svm_get_nr_class(submodel));
             for (j = begin; j < end; j++)
-                target[perm[j]] = svm_predict_probability(submodel, prob->x[perm[j]], prob_estimates);
+                target[perm[j]] = svm_predict_probability(submodel, svm_problem_row(prob, perm[j], row), prob_estimates);
             free(prob_estimates);
         } else
             for (j = begin; j < end; j++)
-                target[perm[j]] = svm_predict(submodel, prob->x[perm[j]]);
+                target[perm[j]] = svm_predict(submodel, svm_problem_row(prob, perm[j], row));
         svm_free_and_destroy_model(&submodel);
         free(subprob.x);
         free(subprob.y);
+        free(subprob.W);
+        free(row);
     }
+#if defined _OPENMP_MY && !defined _OPENCL
+    omp_set_max_active_levels(levels);
+#endif
     free(fold_start);
     free(perm);
 }
@@ -2884,6 +3422,17 @@ const char *svm_check_parameter(const svm_problem *prob, const svm_parameter *pa
     if (param->eps <= 0)
         return "eps <= 0";
 
+    if (param->fold_threads < 0)
+        return "fold_threads < 0";
+
+    if (prob->source != NULL) {
+        if (kernel_type == PRECOMPUTED)
+            return "precomputed kernel needs svm_node rows";
+#ifdef _OPENCL
+        return "OpenCL training needs svm_node rows";
+#endif
+    }
+
     if (svm_type == C_SVC ||
             svm_type == EPSILON_SVR ||
             svm_type == NU_SVR)
@@ -2912,6 +3461,14 @@ const char *svm_check_parameter(const svm_problem *prob, const svm_parameter *pa
             svm_type == ONE_CLASS)
         return "one-class SVM probability output not supported yet";
 
+    // instance weights scale C, nu formulations have no C
+    if (prob->W != NULL) {
+        if (svm_type != C_SVC && svm_type != EPSILON_SVR)
+            return "instance weights are supported only for C-SVC and epsilon-SVR";
+        for (int i = 0; i < prob->l; i++)
+            if (prob->W[i] < 0)
+                return "instance weight < 0";
+    }
 
     // check whether nu-svc is feasible
 
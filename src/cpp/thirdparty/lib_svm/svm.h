@@ -15,11 +15,21 @@ struct svm_node
 	double value;
 };
 
+/* dense rows kept outside of svm_node arrays, e.g. memory mapped training set */
+struct svm_row_source
+{
+	int dim;		/* features of each row, indices 1..dim */
+	const void *data;
+	double (*get_value)(const void *data, int row, int index);	/* index is 0..dim-1 */
+};
+
 struct svm_problem
 {
 	int l;
 	double *y;
-	struct svm_node **x;
+	struct svm_node **x;	/* with source, x[i] is one node: index -1, value row in source */
+	double *W;		/* instance weights scaling C, NULL when all weights are 1 */
+	const struct svm_row_source *source;	/* NULL when x holds features */
 };
 
 enum { C_SVC, NU_SVC, ONE_CLASS, EPSILON_SVR, NU_SVR };	/* svm_type */
@@ -44,6 +54,8 @@ struct svm_parameter
 	double p;	/* for EPSILON_SVR */
 	int shrinking;	/* use the shrinking heuristics */
 	int probability; /* do probability estimates */
+	int fold_threads; /* for cross validation, folds trained at once, 0 for all folds */
+	int quiet; /* no output of this training, other trainings keep printing */
 };
 
 //
@@ -72,7 +84,13 @@ struct svm_model
 };
 
 struct svm_model *svm_train(const struct svm_problem *prob, const struct svm_parameter *param);
+/* init_alpha (may be NULL) starts solver from given coefficients, alpha (may be NULL) receives
+   coefficients y_i * alpha_i of all instances; used only for two class C-SVC, otherwise alpha is 0 */
+struct svm_model *svm_train_warm_start(const struct svm_problem *prob, const struct svm_parameter *param,
+				       const double *init_alpha, double *alpha);
 void svm_cross_validation(const struct svm_problem *prob, const struct svm_parameter *param, int nr_fold, double *target);
+/* features of instance i for prediction, rows of source are written to buffer of source->dim + 1 nodes */
+const struct svm_node *svm_problem_row(const struct svm_problem *prob, int i, struct svm_node *buffer);
 
 int svm_save_model(const char *model_file_name, const struct svm_model *model);
 struct svm_model *svm_load_model(const char *model_file_name);
@@ -0,0 +1,31 @@
+#!/bin/bash
+# Measures SMO solver wall time per iteration of -training for several OpenMP
+# thread counts and writes table for plotPerformanceSolver.plot.
+# Run from directory with ShadowDetectionConfig.xml, solver loops shorter than
+# SOLVER_PARALLEL_MIN stay sequential, to compare thresholds rebuild with
+# CXXFLAGS=-DSOLVER_PARALLEL_MIN=<value>
+#
+# usage: benchmarkSolver.sh <shadowdetection binary> <training set> [output] [thread counts]
+
+if [ $# -lt 2 ]; then
+    echo "usage: $0 <shadowdetection binary> <training set> [output] [thread counts]"
+    exit 1
+fi
+BINARY=$1
+TRAINING_SET=$2
+OUTPUT=${3:-solver.dat}
+THREADS=${4:-"1 4 16 32"}
+MODEL=$(mktemp)
+
+printf "Threads\tms per iteration\titerations\tseconds\n" > "$OUTPUT"
+for t in $THREADS; do
+    START=$(date +%s.%N)
+    LOG=$(OMP_NUM_THREADS=$t "$BINARY" -training "$TRAINING_SET" "$MODEL")
+    END=$(date +%s.%N)
+    # one line per trained sub problem, iterations and their time are summed
+    echo "$LOG" | awk -v t=$t -v s=$START -v e=$END '
+        /optimization finished/ { gsub(",", ""); it += $5; ms += $5 * $6 }
+        END { if (it > 0) printf "%d\t%.4f\t%d\t%.2f\n", t, ms / it, it, e - s }' >> "$OUTPUT"
+done
+rm -f "$MODEL"
+cat "$OUTPUT"
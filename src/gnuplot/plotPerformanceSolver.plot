@@ -0,0 +1,16 @@
+set boxwidth 0.9 absolute
+set style fill   solid 1.00 border lt -1
+set key inside right top vertical Right noreverse noenhanced autotitle nobox
+set style histogram clustered gap 1 title textcolor lt -1
+set datafile separator "\t"
+set style data histograms
+set xtics  norangelimit
+set xtics   ()
+set xlabel "OpenMP threads"
+set title "Solver time per iteration (ms), made by benchmarkSolver.sh" 
+set yrange [ 0.00000 : * ] noreverse nowriteback
+plot 'solver.dat' using 2:xtic(1) ti col
+set term svg size 1280,720
+set output "performancesSolver.svg"
+replot
+set term x11